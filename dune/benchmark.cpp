@@ -0,0 +1,1195 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Benchmark of the kd-tree point locator.
+ *
+ * Builds a structured grid of configurable dimension, size and element type, measures the
+ * build time and resident memory of the locator, the size of its search structures in
+ * double or float precision and flat or packed nodes and the throughput and latency
+ * distribution of point queries for several query distributions. The point set is also
+ * located as one batch, in the given order, sorted along the Morton curve and sorted with
+ * a group of interleaved queries in flight. Where the kernel grants
+ * access to the hardware counters, cache misses per query are measured over the throughput
+ * loop as well. Results are printed and optionally appended to a CSV file or written to a
+ * JSON file for regression tracking.
+ */
+
+#include <utils/utils.hpp>
+#include <utils/alloccounter.hpp>
+#include <utils/perfcounters.hpp>
+#include <math/shortvector.hpp>
+
+#include <fem/dune.h>
+#include <fem/meshgenerator.hpp>
+#include <tree/pointlocator.hpp>
+#include <error/duneerror.hpp>
+#include <error/ioerror.hpp>
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+
+//=======================================================================================================
+// grid setup
+//=======================================================================================================
+template< unsigned dim_ >
+struct SimplexBenchmarkTraits {
+    enum {dim = dim_, dimw = dim_, simplex = 1};
+    typedef typename Dune::ALUSimplexGrid< dim, dimw >  GridType;
+    typedef typename GridType::LeafGridView             GridView;
+    typedef typename GridView::ctype                    Coord;
+
+    static const std::string name() { return "simplex"; }
+};
+
+template< unsigned dim_ >
+struct CubeBenchmarkTraits {
+    enum {dim = dim_, dimw = dim_, simplex = 0};
+    typedef typename Dune::ALUCubeGrid< dim, dimw >     GridType;
+    typedef typename GridType::LeafGridView             GridView;
+    typedef typename GridView::ctype                    Coord;
+
+    static const std::string name() { return "cube"; }
+};
+
+
+//=======================================================================================================
+// options and results
+//=======================================================================================================
+struct BenchmarkOptions {
+    unsigned                    dim;
+    std::string                 element;
+    unsigned                    elements;       //!> cells per direction
+    unsigned long               cells;          //!> approximate number of coarse cells, overrides elements
+    double                      grading;        //!> boundary layer strength in all directions
+    double                      anisotropy;     //!> cell aspect ratio
+    unsigned                    hotSpots;       //!> number of randomly placed locally refined balls
+    unsigned                    hotSpotLevels;
+    unsigned                    queries;        //!> points per scenario
+    unsigned                    repeat;         //!> passes over the point set for the throughput
+    unsigned                    checkAlloc;     //!> queries that must not allocate, 0 disables the check
+    unsigned                    group;          //!> queries in flight of the interleaved batch search
+    bool                        micro;          //!> run the vector and traversal kernel microbenchmarks only
+    bool                        verify;         //!> compare the cells found by a flat double and a packed float locator
+    unsigned                    seed;
+    std::string                 ordering;       //!> space filling curve of the locator's memory layout
+    std::string                 precision;      //!> number type of split values and cull boxes
+    std::string                 nodes;          //!> node format of the locator, flat or packed
+    unsigned long               budget;         //!> bytes the locator may use, 0 for no limit
+    std::vector<std::string>    scenarios;
+    std::string                 csv;
+    std::string                 json;
+
+    BenchmarkOptions() : dim(2), element("simplex"), elements(64), cells(0), grading(0.), anisotropy(1.),
+                         hotSpots(0), hotSpotLevels(3), queries(100000), repeat(5), checkAlloc(0), group(16), micro(false), verify(false), seed(1),
+                         ordering("hilbert"), precision("double"), nodes("flat"), budget(0), scenarios({"uniform", "clustered", "trajectory", "boundary"}) {}
+};
+
+struct BenchmarkResult {
+    std::string     element;
+    unsigned        dim;
+    unsigned        cells;
+    double          grading;
+    double          anisotropy;
+    unsigned        hotSpots;
+    std::string     scenario;
+    unsigned        queries;
+    unsigned        misses;         //!> points not located although inside the domain
+    double          buildTime;      //!> [s]
+    long            memory;         //!> resident memory growth by the locator [bytes]
+    unsigned long   searchMemory;   //!> nodes, leaf cell lists and cull boxes [bytes]
+    double          throughput;     //!> [queries/s]
+    double          mean;           //!> latency [ns]
+    double          p50;
+    double          p90;
+    double          p99;
+    double          max;
+    std::string     ordering;
+    double          l1Misses;       //!> L1 data cache load misses per query, -1 if not available
+    double          llcMisses;      //!> last level cache load misses per query, -1 if not available
+    double          batch;          //!> throughput of batches in the given order [queries/s]
+    double          batchSorted;    //!> throughput of batches sorted along the Morton curve [queries/s]
+    double          batchGroup;     //!> throughput of sorted batches with interleaved queries [queries/s]
+    std::string     precision;
+    std::string     nodes;
+};
+
+//! resident set size of the process in bytes, 0 if /proc is not available
+inline long residentMemory() {
+    std::ifstream statm( "/proc/self/statm" );
+    long size = 0, resident = 0;
+    if ( !(statm >> size >> resident) ) return 0;
+    return resident * sysconf( _SC_PAGESIZE );
+}
+
+
+inline const tree::NodeFormat parseNodeFormat( const std::string& s ) {
+    if ( s == "flat"   ) return tree::NodeFormat::Flat;
+    if ( s == "packed" ) return tree::NodeFormat::Packed;
+    throw std::invalid_argument( "Unknown node format '" + s + "'!" );
+}
+
+inline const geometry::SpaceFillingCurve parseOrdering( const std::string& s ) {
+    if ( s == "none"    ) return geometry::SpaceFillingCurve::None;
+    if ( s == "morton"  ) return geometry::SpaceFillingCurve::Morton;
+    if ( s == "hilbert" ) return geometry::SpaceFillingCurve::Hilbert;
+    throw std::invalid_argument( "Unknown ordering '" + s + "'!" );
+}
+
+//! counter value per query, -1 if the counter is not available
+inline const double perQuery( const profiling::PerfCounters& pc, const profiling::PerfCounters::Event e, const double n ) {
+    return pc.available( e ) ? pc.value( e )/n : -1.;
+}
+
+
+//=======================================================================================================
+// query distributions on the box [lower, upper]
+//=======================================================================================================
+template< unsigned dim >
+class QueryGenerator {
+public:
+    typedef math::ShortVector< double, dim >  Point;
+
+protected:
+    const double    lower;
+    const double    upper;
+    const double    h;              //!> cell size
+    std::mt19937&   rng;
+
+    const double uniform( const double a, const double b ) {
+        return std::uniform_real_distribution<double>( a, b )( rng );
+    }
+
+    const bool inside( const Point& x ) const {
+        for ( unsigned k = 0; k < dim; k++ )
+            if ( (x(k) < lower) || (x(k) > upper) ) return false;
+        return true;
+    }
+
+public:
+    QueryGenerator( const double lower_, const double upper_, const double h_, std::mt19937& rng_ ) :
+        lower(lower_), upper(upper_), h(h_), rng(rng_) {}
+
+    //! independent points, uniform in the domain
+    void uniform( std::vector< Point >& pts, const unsigned n ) {
+        pts.resize( n );
+        for ( auto& x : pts )
+            for ( unsigned k = 0; k < dim; k++ )
+                x(k) = uniform( lower, upper );
+    }
+
+    //! gaussian clusters of a few cells width around random centers
+    void clustered( std::vector< Point >& pts, const unsigned n, const unsigned numClusters = 8 ) {
+        std::vector< Point > centers;
+        uniform( centers, numClusters );
+        std::normal_distribution<double> N( 0., 4.*h );
+
+        pts.resize( n );
+        for ( auto& x : pts ) {
+            const Point& c = centers[ std::uniform_int_distribution<unsigned>( 0, numClusters-1 )( rng ) ];
+            do {
+                for ( unsigned k = 0; k < dim; k++ )
+                    x(k) = c(k) + N( rng );
+            } while ( !inside( x ) );
+        }
+    }
+
+    //! random walk with steps of a fraction of the cell size, reflected at the boundary
+    void trajectory( std::vector< Point >& pts, const unsigned n ) {
+        std::normal_distribution<double> N( 0., 1. );
+        Point x, v;
+        for ( unsigned k = 0; k < dim; k++ ) {
+            x(k) = uniform( lower, upper );
+            v(k) = N( rng );
+        }
+
+        pts.resize( n );
+        for ( auto& p : pts ) {
+            // slowly turning direction
+            for ( unsigned k = 0; k < dim; k++ )
+                v(k) += .1*N( rng );
+            v *= .25*h/math::norm( v );
+
+            for ( unsigned k = 0; k < dim; k++ ) {
+                x(k) += v(k);
+                if ( x(k) < lower ) { x(k) = 2.*lower - x(k); v(k) = -v(k); }
+                if ( x(k) > upper ) { x(k) = 2.*upper - x(k); v(k) = -v(k); }
+            }
+            p = x;
+        }
+    }
+
+    //! points within a small fraction of a cell of the domain boundary
+    void boundary( std::vector< Point >& pts, const unsigned n ) {
+        pts.resize( n );
+        for ( auto& x : pts ) {
+            for ( unsigned k = 0; k < dim; k++ )
+                x(k) = uniform( lower, upper );
+
+            const unsigned  face = std::uniform_int_distribution<unsigned>( 0, 2*dim-1 )( rng );
+            const double    eps  = uniform( 0., 1e-3*h );
+            x(face/2) = (face % 2) ? upper - eps : lower + eps;
+        }
+    }
+
+    void generate( const std::string& scenario, std::vector< Point >& pts, const unsigned n ) {
+        if      ( scenario == "uniform"    ) uniform   ( pts, n );
+        else if ( scenario == "clustered"  ) clustered ( pts, n );
+        else if ( scenario == "trajectory" ) trajectory( pts, n );
+        else if ( scenario == "boundary"   ) boundary  ( pts, n );
+        else throw std::invalid_argument( "Unknown query scenario '" + scenario + "'!" );
+    }
+};
+
+
+//=======================================================================================================
+// benchmark
+//=======================================================================================================
+//! geometric part of a point evaluation in the cell found, the grid accesses of a fem evaluation without its coefficients
+template< class EntityData >
+const double evalGeometry( const EntityData& ed ) {
+    const auto& geo = ed.entity.geometry();
+    const auto  xg  = geo.global( ed.xl );
+    const auto  jit = geo.jacobianInverseTransposed( ed.xl );
+    return xg[0] + jit[0][0];
+}
+
+//! run checkAlloc queries through locate, findEntity and the evaluation, returns the number of heap allocations
+template< class Locator, class Point >
+const unsigned long checkAllocations( Locator& locator, const std::vector< Point >& pts, const unsigned n ) {
+    unsigned long sink = 0;
+    double        u    = 0.;
+
+    // warm up, the grid may fill its entity pools and thread local scratch space is set up,
+    // the batch sets up the buffers it keeps
+    for ( const auto& x : pts ) {
+        const auto ed = locator.findEntity( x );
+        sink += ed.index;
+        u    += evalGeometry( ed );
+    }
+
+    typename Locator::BatchResult::Points batch;
+    typename Locator::BatchResult         batchResult;
+    math::gather( pts, batch );
+    locator.locate( batch, batchResult, true, 1 );
+
+    alloc::AllocationCounter count;
+    for ( unsigned k = 0; k < n; k++ ) {
+        const auto& x   = pts[ k % pts.size() ];
+        const auto  res = locator.locate( x );
+        const auto  ed  = locator.findEntity( x );
+        sink += res.entity->_index + ed.index;
+        u    += evalGeometry( ed );
+    }
+    locator.locate( batch, batchResult, true, 1 );
+    locator.locate( batch, batchResult, true, 16 );
+    sink += batchResult.found();
+    const unsigned long allocations = count.allocations();
+
+    if ( (sink == 1) || (u == 1.) ) std::cout << std::endl;
+    return allocations;
+}
+
+//! create the benchmark grid, hot spots are placed with rng
+template< class BT >
+Dune::shared_ptr< typename BT::GridType > createGrid( const BenchmarkOptions& opt, const double lower, const double upper,
+                                                      std::mt19937& rng, typename fem::MeshGenerator< BT >::Parameters& param ) {
+    typedef fem::MeshGenerator< BT >                    MeshGenerator;
+
+    std::uniform_real_distribution<double> U( lower, upper );
+
+    param.lower = lower;
+    param.upper = upper;
+    param.elements.fill( opt.elements );
+    param.grading.fill( opt.grading );
+    if ( opt.cells > 0 )
+        MeshGenerator::setCellCount( param, opt.cells, opt.anisotropy );
+    else
+        param.elements[0] = static_cast<unsigned>( opt.anisotropy*opt.elements );
+
+    for ( unsigned k = 0; k < opt.hotSpots; k++ ) {
+        typename MeshGenerator::GlobalCoord c;
+        for ( unsigned d = 0; d < BT::dimw; d++ )
+            c[d] = U( rng );
+        param.hotSpots.push_back( typename MeshGenerator::HotSpot( c, .05*(upper-lower), opt.hotSpotLevels ) );
+    }
+
+    std::cout << CE_STATUS << "Create " << BT::name() << " grid, dim " << BT::dim << ", "
+              << MeshGenerator::numCells( param ) << " coarse cells" << CE_RESET << std::endl;
+    return MeshGenerator::create( param );
+}
+
+template< class BT, typename IndexReal >
+const bool benchmark( const BenchmarkOptions& opt, std::vector< BenchmarkResult >& results ) {
+    typedef typename BT::GridType                       GridType;
+    typedef typename BT::GridView                       GridView;
+    typedef tree::PointLocator< GridView, IndexReal >   Locator;
+    typedef typename QueryGenerator< BT::dim >::Point   Point;
+    typedef std::chrono::steady_clock                   Clock;
+
+    typedef fem::MeshGenerator< BT >                    MeshGenerator;
+
+    const double lower = -1.;
+    const double upper =  1.;
+
+    std::mt19937 rng( opt.seed );
+
+    typename MeshGenerator::Parameters param;
+    Dune::shared_ptr< GridType > pgrid = createGrid< BT >( opt, lower, upper, rng, param );
+    const GridView gv = pgrid->leafView();
+
+    const long      m0 = residentMemory();
+    const auto      t0 = Clock::now();
+    Locator         locator( gv, false, parseOrdering( opt.ordering ), parseNodeFormat( opt.nodes ), opt.budget );
+    const double    buildTime = std::chrono::duration<double>( Clock::now() - t0 ).count();
+    const long      memory    = residentMemory() - m0;
+
+    std::cout << CE_STATUS << "Build " << CE_RESET << buildTime << " s, " << memory << " bytes, "
+              << gv.size(0) << " cells, " << opt.ordering << " order, " << opt.precision << " " << opt.nodes << " index of "
+              << locator.searchMemory() << " bytes" << std::endl;
+    if ( opt.budget > 0 ) {
+        std::cout << CE_STATUS << "Budget " << CE_RESET << opt.budget << " bytes, " << locator.memoryStats().total()
+                  << " bytes used, " << tree::asString( locator.format() ) << " nodes, at most " << locator.leafSize()
+                  << " vertices per leaf" << std::endl;
+        locator.queryCost().operator<<( std::cout );
+    }
+
+    const unsigned nmax = *std::max_element( param.elements.begin(), param.elements.end() );
+    QueryGenerator< BT::dim > gen( lower, upper, (upper-lower)/nmax, rng );
+    std::vector< Point >  pts;
+    std::vector< double > latency( opt.queries );
+    math::ShortVectorArray< double, BT::dim >           batch;
+    typename Locator::BatchResult                       batchResult;
+    unsigned long         sink = 0;
+    profiling::PerfCounters counters;
+
+    if ( !counters.available() )
+        std::cout << CE_WARNING << "Hardware counters not available, check perf_event_paranoid" << CE_RESET << std::endl;
+
+    for ( const auto& scenario : opt.scenarios ) {
+        gen.generate( scenario, pts, opt.queries );
+        locator.resetQueryStats();
+
+        // warm up and count points the locator misses
+        unsigned misses = 0;
+        for ( const auto& x : pts ) {
+            const auto res = locator.locate( x );
+            if ( res.found ) sink += res.entity->_index;
+            else             misses++;
+        }
+
+        // throughput over the whole point set
+        const auto t1 = Clock::now();
+        counters.start();
+        for ( unsigned r = 0; r < opt.repeat; r++ )
+            for ( const auto& x : pts ) {
+                const auto res = locator.locate( x );
+                if ( res.found ) sink += res.entity->_index;
+            }
+        counters.stop();
+        const double ta = std::chrono::duration<double>( Clock::now() - t1 ).count();
+        const double nq = static_cast<double>( opt.repeat )*pts.size();
+
+        // the point set as one batch, as given, sorted along the curve and sorted with interleaved queries
+        math::gather( pts, batch );
+        double tb[3];
+        for ( unsigned s = 0; s < 3; s++ ) {
+            const auto t3 = Clock::now();
+            for ( unsigned r = 0; r < opt.repeat; r++ ) {
+                locator.locate( batch, batchResult, s > 0, s == 2 ? opt.group : 1 );
+                sink += batchResult.found();
+            }
+            tb[s] = std::chrono::duration<double>( Clock::now() - t3 ).count();
+        }
+
+        // latency of single queries, includes the clock overhead
+        for ( unsigned k = 0; k < pts.size(); k++ ) {
+            const auto t2  = Clock::now();
+            const auto res = locator.locate( pts[k] );
+            if ( res.found ) sink += res.entity->_index;
+            latency[k] = std::chrono::duration<double, std::nano>( Clock::now() - t2 ).count();
+        }
+        std::sort( latency.begin(), latency.end() );
+
+        const auto percentile = [&]( const double p ) { return latency[ static_cast<unsigned>( p*(latency.size()-1) ) ]; };
+
+        BenchmarkResult res;
+        res.element    = BT::name();
+        res.dim        = BT::dim;
+        res.cells      = gv.size(0);
+        res.grading    = opt.grading;
+        res.anisotropy = opt.anisotropy;
+        res.hotSpots   = opt.hotSpots;
+        res.scenario   = scenario;
+        res.queries    = opt.queries;
+        res.misses     = misses;
+        res.buildTime  = buildTime;
+        res.memory     = memory;
+        res.searchMemory = locator.searchMemory();
+        res.throughput = static_cast<double>( opt.repeat )*pts.size()/ta;
+        res.mean       = 1e9*ta/( static_cast<double>( opt.repeat )*pts.size() );
+        res.p50        = percentile( .5  );
+        res.p90        = percentile( .9  );
+        res.p99        = percentile( .99 );
+        res.max        = latency.back();
+        res.ordering   = opt.ordering;
+        res.l1Misses   = perQuery( counters, profiling::PerfCounters::L1D_MISSES, nq );
+        res.llcMisses  = perQuery( counters, profiling::PerfCounters::LLC_MISSES, nq );
+        res.batch       = nq/tb[0];
+        res.batchSorted = nq/tb[1];
+        res.batchGroup  = nq/tb[2];
+        res.precision   = opt.precision;
+        res.nodes       = opt.nodes;
+        results.push_back( res );
+
+        std::cout << CE_STATUS << std::setw(12) << std::left << scenario << CE_RESET
+                  << std::setw(12) << res.throughput << " q/s"
+                  << "   mean "   << res.mean << " ns"
+                  << "   p50 "    << res.p50  << "   p90 " << res.p90 << "   p99 " << res.p99 << "   max " << res.max
+                  << "   misses " << misses   << std::endl;
+        std::cout << std::setw(12) << " " << std::setw(12) << res.batch << " q/s batch   "
+                  << res.batchSorted << " q/s batch sorted   "
+                  << res.batchGroup  << " q/s batch sorted, " << opt.group << " in flight" << std::endl;
+        if ( counters.available() )
+            std::cout << std::setw(12) << " " << "per query   L1d misses " << res.l1Misses << "   LLC misses " << res.llcMisses
+                      << "   cycles " << perQuery( counters, profiling::PerfCounters::CYCLES, nq )
+                      << "   dTLB misses " << perQuery( counters, profiling::PerfCounters::DTLB_MISSES, nq ) << std::endl;
+
+        if ( tree::queryStatsEnabled ) {
+            typename tree::Node< GridView >::TreeStats ts;
+            locator.fillTreeStats( ts );
+            ts.queries.operator<<( std::cout ) << std::endl;
+        }
+    }
+
+    if ( sink == 1 ) std::cout << std::endl;    // keep the queries from being optimized away
+
+    if ( opt.checkAlloc > 0 ) {
+        gen.uniform( pts, std::min( opt.checkAlloc, opt.queries ) );
+        const unsigned long n = checkAllocations( locator, pts, opt.checkAlloc );
+        if ( n > 0 ) {
+            std::cout << CE_ERROR << n << " heap allocations in " << opt.checkAlloc << " queries" << CE_RESET << std::endl;
+            return false;
+        }
+        std::cout << CE_STATUS << "No heap allocations in " << opt.checkAlloc << " queries" << CE_RESET << std::endl;
+    }
+    return true;
+}
+
+
+template< class BT >
+const bool benchmark( const BenchmarkOptions& opt, std::vector< BenchmarkResult >& results ) {
+    if ( opt.precision == "double" ) return benchmark< BT, double >( opt, results );
+    if ( opt.precision == "float"  ) return benchmark< BT, float  >( opt, results );
+    throw std::invalid_argument( "Unknown precision '" + opt.precision + "'!" );
+}
+
+
+//! locate the same points with a flat double and a packed float locator and compare the cells found
+template< class BT >
+const bool verify( const BenchmarkOptions& opt ) {
+    typedef typename BT::GridType                               GridType;
+    typedef typename BT::GridView                               GridView;
+    typedef tree::PointLocator< GridView, double >              FlatLocator;
+    typedef tree::PointLocator< GridView, float  >              PackedLocator;
+    typedef typename QueryGenerator< BT::dim >::Point           Point;
+
+    typedef fem::MeshGenerator< BT >                            MeshGenerator;
+
+    const double lower = -1.;
+    const double upper =  1.;
+
+    std::mt19937 rng( opt.seed );
+
+    typename MeshGenerator::Parameters param;
+    Dune::shared_ptr< GridType > pgrid = createGrid< BT >( opt, lower, upper, rng, param );
+    const GridView gv = pgrid->leafView();
+
+    const FlatLocator   flat  ( gv, false, parseOrdering( opt.ordering ), tree::NodeFormat::Flat,   opt.budget );
+    const PackedLocator packed( gv, false, parseOrdering( opt.ordering ), tree::NodeFormat::Packed, opt.budget );
+
+    const unsigned nmax = *std::max_element( param.elements.begin(), param.elements.end() );
+    QueryGenerator< BT::dim > gen( lower, upper, (upper-lower)/nmax, rng );
+    std::vector< Point > pts;
+    unsigned long mismatches = 0;
+
+    for ( const auto& scenario : opt.scenarios ) {
+        gen.generate( scenario, pts, opt.queries );
+
+        unsigned long n = 0;
+        for ( const auto& x : pts ) {
+            const auto a = flat.locate( x );
+            const auto b = packed.locate( x );
+            if ( (a.found == b.found) && (!a.found || (a.entity->_index == b.entity->_index)) )
+                continue;
+            if ( n++ < 10 )
+                std::cout << CE_ERROR << scenario << " point " << x << ": flat double "
+                          << ( a.found ? asString( a.entity->_index ) : std::string( "none" ) ) << ", packed float "
+                          << ( b.found ? asString( b.entity->_index ) : std::string( "none" ) ) << CE_RESET << std::endl;
+        }
+        mismatches += n;
+
+        std::cout << CE_STATUS << std::setw(12) << std::left << scenario << CE_RESET
+                  << pts.size() << " points, " << n << " mismatches" << std::endl;
+    }
+
+    if ( mismatches > 0 ) {
+        std::cout << CE_ERROR << mismatches << " points located in different cells" << CE_RESET << std::endl;
+        return false;
+    }
+    std::cout << CE_STATUS << "Flat double and packed float locators agree" << CE_RESET << std::endl;
+    return true;
+}
+
+
+//=======================================================================================================
+// vector kernel microbenchmarks
+//=======================================================================================================
+//! operations of the trajectory loop on math::ShortVector
+template< typename T, unsigned N >
+struct ShortVectorOps {
+    typedef math::ShortVector< T, N >       Vector;
+    typedef math::SmallMatrix< T, N, N >    Matrix;
+
+    static inline T&   at   ( Vector& x, const unsigned k )           { return x(k); }
+    static inline T&   at   ( Matrix& A, const unsigned k )           { return A.data[k]; }
+    static inline void scale( Vector& y, const T a )                  { y *= a; }
+    static inline void axpy ( Vector& y, const T a, const Vector& x ) { math::axpy( y, a, x ); }
+    static inline T    dot  ( const Vector& a, const Vector& b )      { return math::dot( a, b ); }
+    static inline T    norm ( const Vector& a )                       { return math::norm( a ); }
+
+    static inline void verlet( Vector& x, Vector& v, const Vector& g0, const Vector& g1, const T fr, const T c, const T dt ) {
+        const Vector vo = (1-fr*dt)*v - c*dt*g0;
+        v = (1-T(.5)*fr*dt)*v - T(.5)*c*dt*(g0+g1);
+        x = x + T(.5)*dt*(vo+v);
+    }
+    static inline void affine( Vector& x, const Matrix& A, const Vector& xl, const Vector& b ) { x = A*xl + b; }
+};
+
+//! the same operations as plain loops over N components, the reference for ShortVectorOps
+template< typename T, unsigned N >
+struct ScalarOps {
+    struct Vector { T data[N]; };
+    struct Matrix { T data[N*N]; };
+
+    static inline T&   at   ( Vector& x, const unsigned k )           { return x.data[k]; }
+    static inline T&   at   ( Matrix& A, const unsigned k )           { return A.data[k]; }
+    static inline void scale( Vector& y, const T a )                  { for ( unsigned k = 0; k < N; k++ ) y.data[k] *= a; }
+    static inline void axpy ( Vector& y, const T a, const Vector& x ) { for ( unsigned k = 0; k < N; k++ ) y.data[k] += a*x.data[k]; }
+    static inline T    dot  ( const Vector& a, const Vector& b ) {
+        T c = a.data[0]*b.data[0];
+        for ( unsigned k = 1; k < N; k++ )
+            c += a.data[k]*b.data[k];
+        return c;
+    }
+    static inline T    norm ( const Vector& a )                       { return std::sqrt( dot( a, a ) ); }
+
+    static inline void verlet( Vector& x, Vector& v, const Vector& g0, const Vector& g1, const T fr, const T c, const T dt ) {
+        for ( unsigned k = 0; k < N; k++ ) {
+            const T vo = (1-fr*dt)*v.data[k] - c*dt*g0.data[k];
+            v.data[k]  = (1-T(.5)*fr*dt)*v.data[k] - T(.5)*c*dt*(g0.data[k]+g1.data[k]);
+            x.data[k] += T(.5)*dt*(vo+v.data[k]);
+        }
+    }
+    static inline void affine( Vector& x, const Matrix& A, const Vector& xl, const Vector& b ) {
+        for ( unsigned m = 0; m < N; m++ ) {
+            x.data[m] = b.data[m];
+            for ( unsigned n = 0; n < N; n++ )
+                x.data[m] += A.data[m*N+n]*xl.data[n];
+        }
+    }
+};
+
+/*
+ * The velocity-Verlet update of FemTest::integrateVerlet and the affine map x = A xl + b
+ * over a whole ensemble. Both are kept out of line, so the generated code can be read
+ * from the binary, e.g. objdump -dC benchmark | grep -A60 'verletKernel<ShortVectorOps'.
+ */
+template< class Ops, typename T >
+__attribute__((noinline))
+void verletKernel( std::vector< typename Ops::Vector >& x, std::vector< typename Ops::Vector >& v,
+                   const std::vector< typename Ops::Vector >& g0, const std::vector< typename Ops::Vector >& g1,
+                   const T fr, const T c, const T dt ) {
+    for ( unsigned p = 0; p < x.size(); p++ )
+        Ops::verlet( x[p], v[p], g0[p], g1[p], fr, c, dt );
+}
+
+template< class Ops >
+__attribute__((noinline))
+void affineKernel( std::vector< typename Ops::Vector >& x, const std::vector< typename Ops::Vector >& xl,
+                   const typename Ops::Matrix& A, const typename Ops::Vector& b ) {
+    for ( unsigned p = 0; p < x.size(); p++ )
+        Ops::affine( x[p], A, xl[p], b );
+}
+
+/*!
+ * Times dot, axpy, norm, a complete damped trajectory step
+ * v = (1 - fr dt) v - c dt g, x += dt v, the Verlet update and the affine map over a
+ * particle ensemble that fits into cache. Returns ns per call of each kernel.
+ */
+template< class Ops, typename T, unsigned N >
+const std::array< double, 6 > microKernels( const unsigned particles, const unsigned passes, const unsigned seed, double& sink ) {
+    typedef typename Ops::Vector Vector;
+    typedef std::chrono::steady_clock Clock;
+
+    std::mt19937 rng( seed );
+    std::uniform_real_distribution<double> unit( -1., 1. );
+
+    std::vector< Vector > x( particles ), v( particles ), g( particles ), g1( particles );
+    for ( unsigned p = 0; p < particles; p++ )
+        for ( unsigned k = 0; k < N; k++ ) {
+            Ops::at( x[p],  k ) = static_cast<T>( unit( rng ) );
+            Ops::at( v[p],  k ) = static_cast<T>( unit( rng ) );
+            Ops::at( g[p],  k ) = static_cast<T>( unit( rng ) );
+            Ops::at( g1[p], k ) = static_cast<T>( unit( rng ) );
+        }
+
+    typename Ops::Matrix A;
+    Vector b;
+    for ( unsigned k = 0; k < N*N; k++ )
+        Ops::at( A, k ) = static_cast<T>( unit( rng ) );
+    for ( unsigned k = 0; k < N; k++ )
+        Ops::at( b, k ) = static_cast<T>( unit( rng ) );
+
+    const T dt = static_cast<T>( 1e-3 ), fr = static_cast<T>( 0.1 ), c = static_cast<T>( 1. );
+    const double ops = static_cast<double>( particles ) * passes;
+    std::array< double, 6 > ns;
+    T acc = 0;
+
+    auto t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        for ( unsigned p = 0; p < particles; p++ )
+            acc += Ops::dot( v[p], g[p] );
+    ns[0] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        for ( unsigned p = 0; p < particles; p++ )
+            Ops::axpy( x[p], dt, v[p] );
+    ns[1] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        for ( unsigned p = 0; p < particles; p++ )
+            acc += Ops::norm( x[p] );
+    ns[2] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        for ( unsigned p = 0; p < particles; p++ ) {
+            Ops::scale( v[p], 1 - fr*dt );
+            Ops::axpy ( v[p], -c*dt, g[p] );
+            Ops::axpy ( x[p], dt, v[p] );
+            acc += Ops::dot( v[p], g[p] ) + Ops::norm( x[p] );
+        }
+    ns[3] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        verletKernel< Ops, T >( x, v, g, g1, fr, c, dt );
+    ns[4] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    // x is the output, v serves as local coordinates
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ )
+        affineKernel< Ops >( x, v, A, b );
+    ns[5] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / ops;
+
+    for ( unsigned p = 0; p < particles; p++ )
+        acc += Ops::at( x[p], 0 );
+
+    sink += acc;
+    return ns;
+}
+
+template< typename T, unsigned N >
+void microBenchmark( const BenchmarkOptions& opt, const std::string& type, double& sink ) {
+    const unsigned particles = 1024;
+    const unsigned passes    = std::max( 1ul, static_cast<unsigned long>( opt.queries ) * opt.repeat / particles );
+
+    const auto simd   = microKernels< ShortVectorOps< T, N >, T, N >( particles, passes, opt.seed, sink );
+    const auto scalar = microKernels< ScalarOps< T, N >,      T, N >( particles, passes, opt.seed, sink );
+
+    const char* kernel[] = { "dot", "axpy", "norm", "step", "verlet", "affine" };
+    for ( unsigned k = 0; k < 6; k++ )
+        std::cout << std::setw( 6 ) << type << " N=" << N << "  " << std::setw( 6 ) << kernel[k]
+                  << "  ShortVector " << simd[k] << " ns  scalar " << scalar[k] << " ns  speedup "
+                  << std::fixed << std::setprecision( 2 ) << scalar[k] / simd[k]
+                  << std::scientific << std::setprecision( 4 ) << std::endl;
+}
+
+/*
+ * The descent and the cull test of the point locator, instantiated with the generic and the
+ * written out __functor_traversal, e.g. objdump -dC benchmark | grep -A40 'descentKernel<tree'.
+ * The tree is an implicit complete kd tree, node n has the children 2n+1 and 2n+2.
+ */
+template< class Traversal, unsigned dim >
+__attribute__((noinline))
+unsigned long descentKernel( const std::vector< double >& median, const unsigned levels,
+                             const std::vector< std::array< double, dim > >& x ) {
+    unsigned long acc = 0;
+    for ( unsigned q = 0; q < x.size(); q++ ) {
+        unsigned n = 0;
+        for ( unsigned l = 0; l < levels; l++ )
+            n = 2*n + 1 + ( Traversal::coord( x[q].data(), l % dim ) > median[n] );
+        acc += n;
+    }
+    return acc;
+}
+
+template< class Traversal, unsigned dim >
+__attribute__((noinline))
+unsigned long cullKernel( const std::vector< tree::CullBox< double, dim > >& boxes,
+                          const std::vector< std::array< double, dim > >& x ) {
+    unsigned long acc = 0;
+    for ( unsigned q = 0; q < x.size(); q++ )
+        for ( unsigned b = 0; b < boxes.size(); b++ )
+            acc += Traversal::inside( boxes[b], x[q].data() );
+    return acc;
+}
+
+template< unsigned dim >
+void traversalBenchmark( const BenchmarkOptions& opt ) {
+    typedef tree::__functor_traversal< double, dim, false > Generic;
+    typedef tree::__functor_traversal< double, dim, true >  Unrolled;
+    typedef std::chrono::steady_clock Clock;
+
+    const unsigned levels = 12, points = 4096, boxCount = 32;
+    const unsigned passes = std::max( 1ul, static_cast<unsigned long>( opt.queries ) * opt.repeat / points );
+
+    std::mt19937 rng( opt.seed );
+    std::uniform_real_distribution<double> unit( -1., 1. );
+
+    std::vector< std::array< double, dim > > x( points );
+    for ( auto& p : x )
+        for ( unsigned k = 0; k < dim; k++ ) p[k] = unit( rng );
+
+    // medians of a balanced tree over [-1,1]^dim
+    std::vector< double > median( (1u << levels) - 1 );
+    std::vector< std::array< double, 2*dim > > range( median.size() );
+    for ( unsigned k = 0; k < dim; k++ ) { range[0][2*k] = -1.; range[0][2*k+1] = 1.; }
+    for ( unsigned n = 0, l = 0; l < levels; l++ )
+        for ( unsigned m = 0; m < (1u << l); m++, n++ ) {
+            const unsigned a = l % dim;
+            median[n] = .5*( range[n][2*a] + range[n][2*a+1] );
+            if ( 2*n + 2 >= median.size() ) continue;
+            range[2*n+1] = range[n]; range[2*n+1][2*a+1] = median[n];
+            range[2*n+2] = range[n]; range[2*n+2][2*a]   = median[n];
+        }
+
+    std::vector< tree::CullBox< double, dim > > boxes( boxCount );
+    for ( auto& b : boxes )
+        for ( unsigned k = 0; k < dim; k++ ) {
+            const double c = unit( rng );
+            b.lower[k] = c - .5;
+            b.upper[k] = c + .5;
+        }
+
+    unsigned long acc = 0;
+    double ns[4];
+    const double descents = static_cast<double>( points ) * passes;
+    const double tests    = descents * boxCount;
+
+    auto t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ ) acc += descentKernel< Generic, dim >( median, levels, x );
+    ns[0] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / descents;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ ) acc += descentKernel< Unrolled, dim >( median, levels, x );
+    ns[1] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / descents;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ ) acc += cullKernel< Generic, dim >( boxes, x );
+    ns[2] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / tests;
+
+    t0 = Clock::now();
+    for ( unsigned r = 0; r < passes; r++ ) acc += cullKernel< Unrolled, dim >( boxes, x );
+    ns[3] = std::chrono::duration<double, std::nano>( Clock::now() - t0 ).count() / tests;
+
+    std::cout << "  dim=" << dim << "  descent  generic " << ns[0] << " ns  unrolled " << ns[1] << " ns  speedup "
+              << std::fixed << std::setprecision( 2 ) << ns[0] / ns[1] << std::scientific << std::setprecision( 4 ) << std::endl;
+    std::cout << "  dim=" << dim << "     cull  generic " << ns[2] << " ns  unrolled " << ns[3] << " ns  speedup "
+              << std::fixed << std::setprecision( 2 ) << ns[2] / ns[3] << std::scientific << std::setprecision( 4 ) << std::endl;
+
+    if ( acc == 1 ) std::cout << std::endl;
+}
+
+//=======================================================================================================
+// residuals of the SmallMatrix factorizations and solvers
+//=======================================================================================================
+//! largest residual of each solver over a set of random systems, relative to the scale of the system
+template< typename T, unsigned N >
+struct LinearAlgebraResiduals {
+    T           invert, lu, cholesky, solve, batch;
+    bool        singular;       //!> every singular matrix was detected
+
+    LinearAlgebraResiduals() : invert(0), lu(0), cholesky(0), solve(0), batch(0), singular(true) {}
+
+    const T max() const { return std::max( std::max( std::max( invert, lu ), std::max( cholesky, solve ) ), batch ); }
+};
+
+template< typename T, unsigned N >
+const T residual( const math::SmallMatrix< T, N, N >& A, const math::ShortVector< T, N >& x, const math::ShortVector< T, N >& b ) {
+    const math::ShortVector< T, N > r = A*x - b;
+    return math::norm( r ) / ( math::maxabs( A )*math::norm( x ) + math::norm( b ) );
+}
+
+/*!
+ * Solve random diagonally dominant and symmetric positive definite systems with every
+ * solver, and make sure that matrices with two equal rows or a zero row and column are
+ * reported as singular. Regressions in the closed forms of invert() show up here.
+ */
+template< typename T, unsigned N >
+const LinearAlgebraResiduals< T, N > linearAlgebraResiduals( const unsigned systems, const unsigned seed ) {
+    typedef math::SmallMatrix< T, N, N > Matrix;
+    typedef math::ShortVector< T, N >    Vector;
+
+    std::mt19937 rng( seed );
+    std::uniform_real_distribution<T> U( -1, 1 );
+
+    LinearAlgebraResiduals< T, N > res;
+    std::vector< Matrix > As( systems ), Cs( systems );
+    std::vector< Vector > bs( systems ), xs( systems );
+    const Matrix I( T(1) );
+
+    for ( unsigned s = 0; s < systems; s++ ) {
+        Matrix A, B;
+        Vector b;
+        for ( unsigned i = 0; i < N; i++ ) {
+            b.data[i] = U( rng );
+            for ( unsigned j = 0; j < N; j++ ) {
+                A(i,j) = U( rng ) + ( i == j ? T(N) : T(0) );
+                B(i,j) = U( rng );
+            }
+        }
+
+        Matrix C;
+        if ( math::invert( A, C ) ) res.invert = std::max( res.invert, math::maxabs( Matrix( A*C - I ) ) / ( math::maxabs( A )*math::maxabs( C ) ) );
+        else                        res.singular = false;
+
+        math::SmallLU< T, N > F;
+        if ( math::lu( A, F ) ) res.lu = std::max( res.lu, residual( A, Vector( math::solve( F, b ) ), b ) );
+        else                    res.singular = false;
+
+        // B^T B + I is symmetric positive definite
+        const Matrix S = math::transpose( B )*B + I;
+        math::SmallCholesky< T, N > L;
+        if ( math::cholesky( S, L ) ) res.cholesky = std::max( res.cholesky, residual( S, Vector( math::solve( L, b ) ), b ) );
+        else                          res.singular = false;
+
+        Vector x;
+        if ( math::solve( A, b, x ) ) res.solve = std::max( res.solve, residual( A, x, b ) );
+        else                          res.singular = false;
+
+        As[s] = A;
+        bs[s] = b;
+    }
+
+    // the batched versions, with one singular system in the middle
+    const unsigned bad = systems/2;
+    for ( unsigned j = 0; j < N; j++ )
+        As[bad](N-1,j) = ( N > 1 ) ? As[bad](0,j) : T(0);
+    std::unique_ptr< bool[] > inverted( new bool[systems] ), solved( new bool[systems] );
+    if ( (math::invert( As.data(), Cs.data(), systems, inverted.get() ) != 1) ||
+         (math::solve ( As.data(), bs.data(), xs.data(), systems, solved.get() ) != 1) ||
+         inverted[bad] || solved[bad] )
+        res.singular = false;
+    for ( unsigned s = 0; s < systems; s++ ) {
+        if ( s == bad ) continue;
+        res.batch = std::max( res.batch, math::maxabs( Matrix( As[s]*Cs[s] - I ) ) / ( math::maxabs( As[s] )*math::maxabs( Cs[s] ) ) );
+        res.batch = std::max( res.batch, residual( As[s], xs[s], bs[s] ) );
+    }
+
+    // a single singular matrix through every entry point
+    math::SmallLU< T, N >       F;
+    math::SmallCholesky< T, N > L;
+    Matrix Z( As[bad] ), C;
+    Vector x;
+    if ( math::invert( Z, C ) || math::lu( Z, F ) || math::solve( Z, bs[bad], x ) )
+        res.singular = false;
+    try {
+        math::inverse( Z );
+        res.singular = false;
+    } catch ( const SingularMatrixError& ) {}
+    Matrix S( T(1) );
+    S(0,0) = 0;
+    if ( math::cholesky( S, L ) )
+        res.singular = false;
+
+    return res;
+}
+
+//! prints the residuals, returns false if one exceeds a few ulps or a singular matrix was missed
+template< typename T, unsigned N >
+const bool linearAlgebraCheck( const BenchmarkOptions& opt, const std::string& type ) {
+    const auto      res = linearAlgebraResiduals< T, N >( 256, opt.seed );
+    const T         tol = 64*N*std::numeric_limits<T>::epsilon();
+    const bool      ok  = res.singular && (res.max() < tol);
+
+    if ( !ok ) std::cout << CE_ERROR;
+    std::cout << std::setw( 6 ) << type << " N=" << N
+              << "  invert " << res.invert << "  lu " << res.lu << "  cholesky " << res.cholesky
+              << "  solve "  << res.solve  << "  batch " << res.batch
+              << "  singular " << ( res.singular ? "detected" : "missed" );
+    if ( !ok ) std::cout << CE_RESET;
+    std::cout << std::endl;
+    return ok;
+}
+
+
+//! returns false if a residual check of the SmallMatrix solvers failed
+const bool microBenchmarks( const BenchmarkOptions& opt ) {
+    std::cout << CE_STATUS << "SmallMatrix solvers, largest relative residual of 256 random systems" << CE_RESET << std::endl;
+    bool ok = true;
+    ok = linearAlgebraCheck< float,  1 >( opt, "float"  ) && ok;
+    ok = linearAlgebraCheck< float,  2 >( opt, "float"  ) && ok;
+    ok = linearAlgebraCheck< float,  3 >( opt, "float"  ) && ok;
+    ok = linearAlgebraCheck< float,  4 >( opt, "float"  ) && ok;
+    ok = linearAlgebraCheck< float,  5 >( opt, "float"  ) && ok;
+    ok = linearAlgebraCheck< double, 1 >( opt, "double" ) && ok;
+    ok = linearAlgebraCheck< double, 2 >( opt, "double" ) && ok;
+    ok = linearAlgebraCheck< double, 3 >( opt, "double" ) && ok;
+    ok = linearAlgebraCheck< double, 4 >( opt, "double" ) && ok;
+    ok = linearAlgebraCheck< double, 5 >( opt, "double" ) && ok;
+
+    std::cout << CE_STATUS << "ShortVector and SmallMatrix kernels of the integrator" << CE_RESET << std::endl;
+
+    double sink = 0;
+    microBenchmark< float,  2 >( opt, "float",  sink );
+    microBenchmark< float,  3 >( opt, "float",  sink );
+    microBenchmark< float,  4 >( opt, "float",  sink );
+    microBenchmark< double, 2 >( opt, "double", sink );
+    microBenchmark< double, 3 >( opt, "double", sink );
+    microBenchmark< double, 4 >( opt, "double", sink );
+
+    std::cout << CE_STATUS << "point locator traversal, ns per descent of 12 levels and per cull test" << CE_RESET << std::endl;
+    traversalBenchmark< 2 >( opt );
+    traversalBenchmark< 3 >( opt );
+
+    if ( sink == 1. ) std::cout << std::endl;
+    return ok;
+}
+
+
+//=======================================================================================================
+// output
+//=======================================================================================================
+//! append to a CSV file, the header is written if the file is empty
+void writeCSV( const std::string& path, const std::vector< BenchmarkResult >& results ) {
+    std::ofstream out( path.c_str(), std::ios::app );
+    if ( !out ) throw IOError( "Could not open '" + path + "'!", __ERROR_INFO__ );
+
+    if ( out.tellp() == 0 )
+        out << "element,dim,cells,grading,anisotropy,hotspots,scenario,queries,misses,build_s,memory_bytes,throughput_qps,"
+               "mean_ns,p50_ns,p90_ns,p99_ns,max_ns,ordering,l1_misses_pq,llc_misses_pq,batch_qps,batch_sorted_qps,batch_group_qps,"
+               "precision,search_bytes,nodes" << std::endl;
+
+    out.precision( 6 );
+    for ( const auto& r : results )
+        out << r.element    << "," << r.dim  << "," << r.cells << "," << r.grading << "," << r.anisotropy << ","
+            << r.hotSpots   << "," << r.scenario << ","
+            << r.queries    << "," << r.misses << "," << r.buildTime << "," << r.memory << ","
+            << r.throughput << "," << r.mean << "," << r.p50 << "," << r.p90 << "," << r.p99 << "," << r.max << ","
+            << r.ordering   << "," << r.l1Misses << "," << r.llcMisses << "," << r.batch << "," << r.batchSorted << "," << r.batchGroup << ","
+            << r.precision  << "," << r.searchMemory << "," << r.nodes << std::endl;
+}
+
+void writeJSON( const std::string& path, const std::vector< BenchmarkResult >& results ) {
+    std::ofstream out( path.c_str() );
+    if ( !out ) throw IOError( "Could not open '" + path + "'!", __ERROR_INFO__ );
+
+    out.precision( 6 );
+    out << "[" << std::endl;
+    for ( unsigned k = 0; k < results.size(); k++ ) {
+        const auto& r = results[k];
+        out << "  {\"element\": \""   << r.element  << "\", \"dim\": " << r.dim << ", \"cells\": " << r.cells
+            << ", \"grading\": "      << r.grading  << ", \"anisotropy\": " << r.anisotropy << ", \"hotspots\": " << r.hotSpots
+            << ", \"scenario\": \""   << r.scenario << "\""
+            << ", \"queries\": "      << r.queries  << ", \"misses\": " << r.misses
+            << ", \"build_s\": "      << r.buildTime << ", \"memory_bytes\": " << r.memory
+            << ", \"throughput_qps\": " << r.throughput << ", \"mean_ns\": " << r.mean
+            << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90 << ", \"p99_ns\": " << r.p99 << ", \"max_ns\": " << r.max
+            << ", \"ordering\": \"" << r.ordering << "\", \"l1_misses_pq\": " << r.l1Misses << ", \"llc_misses_pq\": " << r.llcMisses
+            << ", \"batch_qps\": " << r.batch << ", \"batch_sorted_qps\": " << r.batchSorted
+            << ", \"batch_group_qps\": " << r.batchGroup
+            << ", \"precision\": \"" << r.precision << "\", \"search_bytes\": " << r.searchMemory
+            << ", \"nodes\": \"" << r.nodes << "\""
+            << "}" << ( k+1 < results.size() ? "," : "" ) << std::endl;
+    }
+    out << "]" << std::endl;
+}
+
+
+//=======================================================================================================
+// main
+//=======================================================================================================
+void printHelp() {
+    std::cout << "Benchmark of the kd-tree point locator" << std::endl;
+    std::cout << std::endl;
+    std::cout << "--dim <2|3>               grid dimension (2)"                                        << std::endl;
+    std::cout << "--element <simplex|cube>  element type (simplex)"                                    << std::endl;
+    std::cout << "--elements <n>            cells per direction (64)"                                  << std::endl;
+    std::cout << "--cells <n>               approximate number of cells, overrides --elements"         << std::endl;
+    std::cout << "--grading <b>             boundary layer grading, 0 is uniform (0)"                  << std::endl;
+    std::cout << "--anisotropy <a>          cell aspect ratio (1)"                                     << std::endl;
+    std::cout << "--hotspots <n>            number of locally refined hot spots (0)"                   << std::endl;
+    std::cout << "--hotspot-levels <n>      refinement levels at the hot spots (3)"                    << std::endl;
+    std::cout << "--queries <n>             query points per scenario (100000)"                        << std::endl;
+    std::cout << "--repeat <n>              passes for the throughput measurement (5)"                 << std::endl;
+    std::cout << "--seed <n>                random seed (1)"                                           << std::endl;
+    std::cout << "--ordering <o>            memory layout of the locator, none, morton, hilbert (hilbert)" << std::endl;
+    std::cout << "--check-alloc <n>         fail if n queries and cell evaluations allocate heap memory"<< std::endl;
+    std::cout << "--group <n>               queries in flight of the interleaved batch search (16)"   << std::endl;
+    std::cout << "--precision <p>           split values and cull boxes in double or float (double)"   << std::endl;
+    std::cout << "--nodes <flat|packed>     node format of the locator (flat)"                         << std::endl;
+    std::cout << "--budget <bytes>          memory budget of the locator, 0 for no limit (0)"          << std::endl;
+    std::cout << "--micro                   check the matrix solvers and run the vector kernel microbenchmarks instead" << std::endl;
+    std::cout << "--verify                  compare flat double and packed float locators, fail on mismatch" << std::endl;
+    std::cout << "--scenarios <a,b,..>      uniform, clustered, trajectory, boundary (all)"            << std::endl;
+    std::cout << "--csv <file>              append results to a CSV file"                              << std::endl;
+    std::cout << "--json <file>             write results to a JSON file"                              << std::endl;
+    std::cout << "-h, --help                This help."                                                << std::endl << std::endl;
+}
+
+const bool parseOptions( int argc, char **argv, BenchmarkOptions& opt ) {
+    for ( int k = 1; k < argc; k++ ) {
+        const std::string arg( argv[k] );
+
+        if ( (arg == "-h") || (arg == "--help") ) return false;
+        if ( arg == "--micro" ) {
+            opt.micro = true;
+            continue;
+        }
+        if ( arg == "--verify" ) {
+            opt.verify = true;
+            continue;
+        }
+        if ( k+1 >= argc ) throw std::invalid_argument( "Missing value for '" + arg + "'!" );
+
+        const std::string val( argv[++k] );
+        if      ( arg == "--dim"            ) opt.dim           = std::stoul( val );
+        else if ( arg == "--element"        ) opt.element       = val;
+        else if ( arg == "--elements"       ) opt.elements      = std::stoul( val );
+        else if ( arg == "--cells"          ) opt.cells         = std::stoul( val );
+        else if ( arg == "--grading"        ) opt.grading       = std::stod( val );
+        else if ( arg == "--anisotropy"     ) opt.anisotropy    = std::stod( val );
+        else if ( arg == "--hotspots"       ) opt.hotSpots      = std::stoul( val );
+        else if ( arg == "--hotspot-levels" ) opt.hotSpotLevels = std::stoul( val );
+        else if ( arg == "--queries"        ) opt.queries       = std::stoul( val );
+        else if ( arg == "--repeat"         ) opt.repeat        = std::stoul( val );
+        else if ( arg == "--seed"           ) opt.seed          = std::stoul( val );
+        else if ( arg == "--ordering"       ) opt.ordering      = val;
+        else if ( arg == "--check-alloc"    ) opt.checkAlloc    = std::stoul( val );
+        else if ( arg == "--group"          ) opt.group         = std::stoul( val );
+        else if ( arg == "--precision"      ) opt.precision     = val;
+        else if ( arg == "--nodes"          ) opt.nodes         = val;
+        else if ( arg == "--budget"         ) opt.budget        = std::stoul( val );
+        else if ( arg == "--csv"            ) opt.csv           = val;
+        else if ( arg == "--json"           ) opt.json          = val;
+        else if ( arg == "--scenarios"      ) {
+            opt.scenarios.clear();
+            std::stringstream ss( val );
+            std::string s;
+            while ( std::getline( ss, s, ',' ) )
+                opt.scenarios.push_back( s );
+        } else
+            throw std::invalid_argument( "Unknown option '" + arg + "'!" );
+    }
+    return true;
+}
+
+int main ( int argc, char **argv ) {
+    Dune::MPIHelper::instance( argc, argv );
+
+    std::cout.setf( std::ios::scientific );
+    std::cout.precision( 4 );
+
+    try {
+        BenchmarkOptions opt;
+        if ( !parseOptions( argc, argv, opt ) ) {
+            printHelp();
+            return 0;
+        }
+
+        if ( opt.micro ) {
+            return microBenchmarks( opt ) ? 0 : 1;
+        }
+
+        if ( opt.verify ) {
+            bool ok = true;
+            if      ( (opt.element == "simplex") && (opt.dim == 2) ) ok = verify< SimplexBenchmarkTraits<2> >( opt );
+            else if ( (opt.element == "simplex") && (opt.dim == 3) ) ok = verify< SimplexBenchmarkTraits<3> >( opt );
+            else if ( (opt.element == "cube"   ) && (opt.dim == 2) ) ok = verify< CubeBenchmarkTraits<2>    >( opt );
+            else if ( (opt.element == "cube"   ) && (opt.dim == 3) ) ok = verify< CubeBenchmarkTraits<3>    >( opt );
+            else throw GridError( "Unsupported grid '" + opt.element + "' of dimension " + asString( opt.dim ) + "!", __ERROR_INFO__ );
+            return ok ? 0 : 1;
+        }
+
+        std::vector< BenchmarkResult > results;
+        bool ok = true;
+        if      ( (opt.element == "simplex") && (opt.dim == 2) ) ok = benchmark< SimplexBenchmarkTraits<2> >( opt, results );
+        else if ( (opt.element == "simplex") && (opt.dim == 3) ) ok = benchmark< SimplexBenchmarkTraits<3> >( opt, results );
+        else if ( (opt.element == "cube"   ) && (opt.dim == 2) ) ok = benchmark< CubeBenchmarkTraits<2>    >( opt, results );
+        else if ( (opt.element == "cube"   ) && (opt.dim == 3) ) ok = benchmark< CubeBenchmarkTraits<3>    >( opt, results );
+        else throw GridError( "Unsupported grid '" + opt.element + "' of dimension " + asString( opt.dim ) + "!", __ERROR_INFO__ );
+
+        if ( !opt.csv.empty()  ) writeCSV ( opt.csv,  results );
+        if ( !opt.json.empty() ) writeJSON( opt.json, results );
+
+        if ( !ok ) return 1;
+
+    } catch ( std::exception & e) {
+        std::cout << " STL ERROR : " << e.what () << std::endl;
+        return 1;
+    } catch ( Dune::Exception & e ) {
+        std::cout << " DUNE ERROR : " << e.what () << std::endl;
+        return 1;
+    } catch (...) {
+        std::cout << " Unknown ERROR " << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
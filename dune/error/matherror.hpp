@@ -72,3 +72,16 @@ public:
         return msg.c_str();
     }
 };
+
+//! the message is built on construction, what() returns a pointer into the error object
+class SingularMatrixError : public BaseError {
+protected:
+    std::string msg;
+
+public:
+    SingularMatrixError( const char* fc, const char* f, const int l ) : BaseError( fc, f, l ), msg( "Matrix is singular! " + where() ) {}
+    
+    virtual const char* what() const noexcept {
+        return msg.c_str();
+    }
+};
@@ -34,6 +34,7 @@
 
 #include <fem/dune.h>
 #include <math/shortvector.hpp>
+#include <math/shortvectorarray.hpp>
 
 
 namespace fem {
@@ -54,6 +55,39 @@ inline const Dune::FieldVector<BT, dim> asFieldVector( const math::ShortVector<B
     return res;       
 }
 
+//! p-th vector of a struct of arrays
+template< typename BT, unsigned dim >
+inline const Dune::FieldVector<BT, dim> asFieldVector( const math::ShortVectorArray<BT, dim>& sva, const unsigned p ) {
+    Dune::FieldVector<BT, dim> res;
+    for ( unsigned k = 0; k < dim; k++ )
+        res[k] = sva(p,k);
+    return res;
+}
+
+//! gather FieldVectors into the struct of arrays layout, dst is resized
+template< class FV, typename BT, unsigned dim >
+inline void gather( const std::vector< FV >& src, math::ShortVectorArray<BT, dim>& dst ) {
+    static_assert( FV::dimension == dim, "Dimension mismatch" );
+    dst.resize( src.size() );
+    for ( unsigned k = 0; k < dim; k++ ) {
+        BT* __restrict__ c = dst.component( k );
+        for ( unsigned p = 0; p < src.size(); p++ )
+            c[p] = src[p][k];
+    }
+}
+
+//! scatter a struct of arrays to FieldVectors, dst is resized
+template< class FV, typename BT, unsigned dim >
+inline void scatter( const math::ShortVectorArray<BT, dim>& src, std::vector< FV >& dst ) {
+    static_assert( FV::dimension == dim, "Dimension mismatch" );
+    dst.resize( src.size() );
+    for ( unsigned k = 0; k < dim; k++ ) {
+        const BT* __restrict__ c = src.component( k );
+        for ( unsigned p = 0; p < src.size(); p++ )
+            dst[p][k] = c[p];
+    }
+}
+
 
 
 }
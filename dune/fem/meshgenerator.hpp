@@ -0,0 +1,256 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file */
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <fem/dune.h>
+
+
+namespace fem {
+
+/*
+ * Synthetic meshes of the box [lower, upper] for scaling studies of the point locator.
+ *
+ * The tensor product lattice of elements[k] cells per direction is stretched per direction
+ * by a tanh boundary layer mapping, which clusters cells at both walls for grading > 0.
+ * Different cell counts per direction give high aspect ratio cells. Hot spots are balls
+ * around which the leaf cells are refined locally a given number of times.
+ * Cubes are inserted as they are, for simplex grids every cube is split into dim! Kuhn
+ * simplices, the same decomposition StructuredGridFactory uses.
+ */
+template< class SetupTraits >
+class MeshGenerator {
+public:
+    typedef typename SetupTraits::GridType                      GridType;
+    typedef typename SetupTraits::Coord                         Coord;
+    typedef typename Dune::FieldVector< Coord, SetupTraits::dimw > GlobalCoord;
+
+    static constexpr unsigned dim     = SetupTraits::dim;
+    static constexpr unsigned dimw    = SetupTraits::dimw;
+    static constexpr bool     simplex = SetupTraits::simplex;
+
+    struct HotSpot {
+        GlobalCoord     center;
+        Coord           radius;
+        unsigned        levels;     //!> number of local refinement steps
+
+        HotSpot( const GlobalCoord& c, const Coord r, const unsigned l ) : center(c), radius(r), levels(l) {}
+    };
+
+    struct Parameters {
+        GlobalCoord                     lower;
+        GlobalCoord                     upper;
+        Dune::array< unsigned, dim >    elements;       //!> cells per direction
+        Dune::array< Coord, dim >       grading;        //!> boundary layer strength per direction, 0 is uniform
+        std::vector< HotSpot >          hotSpots;
+
+        Parameters() : lower(-1.), upper(1.) {
+            elements.fill( 8 );
+            grading.fill( 0. );
+        }
+    };
+
+protected:
+    //! tanh stretching of t in [0,1], symmetric with respect to 1/2
+    static const Coord stretch( const Coord t, const Coord beta ) {
+        if ( beta <= 0. ) return t;
+        return .5*( 1. + std::tanh( beta*(2.*t-1.) )/std::tanh( beta ) );
+    }
+
+    static const unsigned factorial( const unsigned n ) {
+        return ( n < 2 ) ? 1 : n*factorial( n-1 );
+    }
+
+    static void insertVertices( Dune::GridFactory< GridType >& factory, const Parameters& p ) {
+        Dune::array< unsigned, dim > i;
+        i.fill( 0 );
+
+        const unsigned long nv = numVertices( p );
+        for ( unsigned long v = 0; v < nv; v++ ) {
+            GlobalCoord x( 0. );
+            for ( unsigned k = 0; k < dim; k++ ) {
+                const Coord t = static_cast<Coord>( i[k] )/static_cast<Coord>( p.elements[k] );
+                x[k] = p.lower[k] + (p.upper[k]-p.lower[k])*stretch( t, p.grading[k] );
+            }
+            factory.insertVertex( x );
+
+            // lexicographic increment, direction 0 fastest
+            for ( unsigned k = 0; (k < dim) && (++i[k] > p.elements[k]); k++ )
+                i[k] = 0;
+        }
+    }
+
+    static void insertElements( Dune::GridFactory< GridType >& factory, const Parameters& p ) {
+        Dune::GeometryType gt;
+        if ( simplex ) gt.makeSimplex( dim );
+        else           gt.makeCube( dim );
+
+        // vertex index offsets of the cube corners, bit k of the corner is the offset in direction k
+        unsigned long stride[dim];
+        stride[0] = 1;
+        for ( unsigned k = 1; k < dim; k++ )
+            stride[k] = stride[k-1]*(p.elements[k-1]+1);
+
+        Dune::array< unsigned, dim > i;
+        i.fill( 0 );
+
+        std::vector< unsigned int > corners( simplex ? dim+1 : 1u << dim );
+        const unsigned long nc = numCubes( p );
+        for ( unsigned long c = 0; c < nc; c++ ) {
+            unsigned long base = 0;
+            for ( unsigned k = 0; k < dim; k++ )
+                base += i[k]*stride[k];
+
+            if ( simplex ) {
+                // Kuhn simplices, one for every path through the cube along the permuted axes
+                unsigned perm[dim];
+                for ( unsigned k = 0; k < dim; k++ )
+                    perm[k] = k;
+                do {
+                    unsigned long v = base;
+                    corners[0] = v;
+                    for ( unsigned k = 0; k < dim; k++ ) {
+                        v += stride[ perm[k] ];
+                        corners[k+1] = v;
+                    }
+                    factory.insertElement( gt, corners );
+                } while ( std::next_permutation( perm, perm+dim ) );
+            } else {
+                for ( unsigned m = 0; m < corners.size(); m++ ) {
+                    unsigned long v = base;
+                    for ( unsigned k = 0; k < dim; k++ )
+                        if ( m & (1u << k) ) v += stride[k];
+                    corners[m] = v;
+                }
+                factory.insertElement( gt, corners );
+            }
+
+            for ( unsigned k = 0; (k < dim) && (++i[k] == p.elements[k]); k++ )
+                i[k] = 0;
+        }
+    }
+
+    static void refineHotSpots( GridType& grid, const Parameters& p ) {
+        unsigned levels = 0;
+        for ( const auto& hs : p.hotSpots )
+            levels = std::max( levels, hs.levels );
+
+        for ( unsigned l = 0; l < levels; l++ ) {
+            const auto gv = grid.leafView();
+            bool marked = false;
+
+            for ( auto e = gv.template begin<0>(); e != gv.template end<0>(); ++e ) {
+                const auto& geo = e->geometry();
+                const auto  xc  = geo.center();
+                for ( const auto& hs : p.hotSpots ) {
+                    if ( l >= hs.levels ) continue;
+
+                    // distance of the cell center to the ball, tolerating cells larger than the ball
+                    auto d = xc;
+                    d -= hs.center;
+                    const Coord h = (geo.corner(0) - xc).two_norm();
+                    if ( d.two_norm() < hs.radius + h ) {
+                        grid.mark( 1, *e );
+                        marked = true;
+                        break;
+                    }
+                }
+            }
+
+            if ( !marked ) break;
+
+            grid.preAdapt();
+            grid.adapt();
+            grid.postAdapt();
+        }
+    }
+
+public:
+    static const unsigned long numCubes( const Parameters& p ) {
+        unsigned long n = 1;
+        for ( unsigned k = 0; k < dim; k++ )
+            n *= p.elements[k];
+        return n;
+    }
+
+    static const unsigned long numVertices( const Parameters& p ) {
+        unsigned long n = 1;
+        for ( unsigned k = 0; k < dim; k++ )
+            n *= p.elements[k]+1;
+        return n;
+    }
+
+    //! number of cells before hot spot refinement
+    static const unsigned long numCells( const Parameters& p ) {
+        return numCubes( p )*( simplex ? factorial( dim ) : 1 );
+    }
+
+    /*!
+     * Choose the cells per direction such that the coarse mesh has about numCells cells and
+     * the cells have aspect ratio anisotropy, direction 0 being the fine one.
+     */
+    static void setCellCount( Parameters& p, const unsigned long numCells, const Coord anisotropy = 1. ) {
+        const Coord cubes = static_cast<Coord>( numCells )/static_cast<Coord>( simplex ? factorial( dim ) : 1 );
+
+        // n_0 = a n, n_k = n for k > 0, n_0 n^(dim-1) = cubes, scaled by the box extents
+        Coord h = std::pow( cubes/anisotropy, 1./dim );
+        Coord v = 1.;
+        for ( unsigned k = 0; k < dim; k++ )
+            v *= p.upper[k]-p.lower[k];
+        h = std::pow( v, 1./dim )/h;
+
+        for ( unsigned k = 0; k < dim; k++ ) {
+            const Coord hk = ( k == 0 ) ? h/anisotropy : h;
+            p.elements[k] = std::max( 1u, static_cast<unsigned>( std::round( (p.upper[k]-p.lower[k])/hk ) ) );
+        }
+    }
+
+    static typename Dune::shared_ptr< GridType > create( const Parameters& p ) {
+        Dune::GridFactory< GridType > factory;
+
+        insertVertices( factory, p );
+        insertElements( factory, p );
+
+        typename Dune::shared_ptr< GridType > grid( factory.createGrid() );
+        refineHotSpots( *grid, p );
+
+        return grid;
+    }
+};
+
+
+}
@@ -40,8 +40,10 @@
 
 template< typename BT, unsigned dim_, class LocalOperator_, class FunctionOperator_ >
 struct ALUSimplexP1Traits {
-    enum {dim   = dim_,
-          dimw  = dim_};
+    enum {dim               = dim_,
+          dimw              = dim_,
+          simplex           = 1,
+          constantGradient  = 1};                       // P1 on affine simplices
     typedef typename Dune::ALUSimplexGrid< dim, dimw >  GridType;
     typedef typename GridType::LeafGridView             GridView;
     typedef typename GridType::LevelGridView            LevelView;
@@ -98,8 +100,10 @@ struct ALUSimplexP1Traits {
 
 template< typename BT, unsigned dim_, class LocalOperator_, class FunctionOperator_ >
 struct ALUCubeQ1Traits {
-    enum {dim   = dim_,
-          dimw  = dim_};
+    enum {dim               = dim_,
+          dimw              = dim_,
+          simplex           = 0,
+          constantGradient  = 0};
     typedef typename Dune::ALUCubeGrid< dim, dimw > GridType;
     typedef typename GridType::LeafGridView         GridView;
     typedef typename GridType::LevelGridView        LevelView;
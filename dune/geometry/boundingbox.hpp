@@ -62,10 +62,12 @@ public:
 
     BoundingBox( const BoundingBox< T, dim >& bb ) : _empty(bb._empty), dimension(bb.dimension), corner(bb.corner), center(bb.center) {}
 
+    // component wise, p is often assembled component by component just before the call
     const bool isInside( const math::ShortVector< T, dim >& p ) const {
-        const math::ShortVector< T, dim > aux = p - corner;
-        for ( unsigned k = 0; k < dim; k++ )
-            if ( aux(k) > dimension(k) ) return false;
+        for ( unsigned k = 0; k < dim; k++ ) {
+            const T d = p(k) - corner(k);
+            if ( (d < 0) || (d > dimension(k)) ) return false;
+        }
         return true;
     }
 
@@ -91,6 +93,13 @@ public:
         center = corner + .5*dimension;
     }
 
+    void append( const BoundingBox< T, dim >& bb ) {
+        if ( bb._empty ) return;
+        const math::ShortVector< T, dim > upper = bb.corner + bb.dimension;
+        append( bb.corner );
+        append( upper );
+    }
+
     const BoundingBox<T, dim> split( const unsigned orientation, const T ratio, const bool left ) const {
         BoundingBox<T, dim> bb( *this );
 
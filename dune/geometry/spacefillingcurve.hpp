@@ -0,0 +1,254 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Keys of points along space filling curves.
+ *
+ * Coordinates are quantized relative to a bounding box to 64/dim bits each and interleaved
+ * into a 64 bit key, coordinate 0 taking the most significant bit of every group. Sorting
+ * by the key places points that are close in space close in memory. The Hilbert key is
+ * computed from the transposed Hilbert index of J. Skilling, "Programming the Hilbert
+ * curve", AIP Conf. Proc. 707 (2004).
+ *
+ * MortonOrder sorts batches of query points with a radix sort over coarser keys, enough to
+ * make consecutive queries touch the same part of a tree.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <math/shortvector.hpp>
+#include <math/shortvectorarray.hpp>
+#include <geometry/boundingbox.hpp>
+
+namespace geometry {
+
+enum class SpaceFillingCurve {
+    None,       //!> keep the given order
+    Morton,     //!> Z-order, cheap to compute
+    Hilbert     //!> no jumps between consecutive cells, better locality
+};
+
+inline const std::string asString( const SpaceFillingCurve c ) {
+    switch ( c ) {
+        case SpaceFillingCurve::Morton:  return "morton";
+        case SpaceFillingCurve::Hilbert: return "hilbert";
+        default:                         return "none";
+    }
+}
+
+//! bits per coordinate
+template< unsigned dim >
+struct SfcBits { enum { value = 64/dim }; };
+
+
+//======= bit interleaving ==============================================================
+template< unsigned dim >
+struct __functor_sfc_interleave {
+    static inline uint64_t key( const uint32_t (&q)[dim] ) {
+        uint64_t k = 0;
+        for ( int b = SfcBits<dim>::value-1; b >= 0; b-- )
+            for ( unsigned d = 0; d < dim; d++ )
+                k = (k << 1) | ((q[d] >> b) & 1u);
+        return k;
+    }
+};
+
+template<>
+struct __functor_sfc_interleave< 2 > {
+    static inline uint64_t spread( const uint32_t v ) {
+        uint64_t x = v;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x <<  8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x <<  4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x <<  2)) & 0x3333333333333333ull;
+        x = (x | (x <<  1)) & 0x5555555555555555ull;
+        return x;
+    }
+
+    static inline uint64_t key( const uint32_t (&q)[2] ) {
+        return (spread( q[0] ) << 1) | spread( q[1] );
+    }
+};
+
+template<>
+struct __functor_sfc_interleave< 3 > {
+    static inline uint64_t spread( const uint32_t v ) {
+        uint64_t x = v & 0x1FFFFFu;
+        x = (x | (x << 32)) & 0x001F00000000FFFFull;
+        x = (x | (x << 16)) & 0x001F0000FF0000FFull;
+        x = (x | (x <<  8)) & 0x100F00F00F00F00Full;
+        x = (x | (x <<  4)) & 0x10C30C30C30C30C3ull;
+        x = (x | (x <<  2)) & 0x1249249249249249ull;
+        return x;
+    }
+
+    static inline uint64_t key( const uint32_t (&q)[3] ) {
+        return (spread( q[0] ) << 2) | (spread( q[1] ) << 1) | spread( q[2] );
+    }
+};
+
+
+//======= keys ==========================================================================
+//! integer coordinates of x in [0, 2^bits), points outside the box are clamped
+template< typename T, unsigned dim >
+inline void quantize( const math::ShortVector< T, dim >& x, const BoundingBox< T, dim >& box, uint32_t (&q)[dim],
+                      const unsigned bits = SfcBits<dim>::value ) {
+    const T cells = static_cast<T>( (uint64_t(1) << bits) - 1 );
+    for ( unsigned k = 0; k < dim; k++ ) {
+        const T s = box.dimension(k) > 0 ? (x(k) - box.corner(k))/box.dimension(k) : 0;
+        q[k] = static_cast<uint32_t>( cells*std::min( std::max( s, T(0) ), T(1) ) );
+    }
+}
+
+template< unsigned dim >
+inline uint64_t mortonKey( const uint32_t (&q)[dim] ) {
+    return __functor_sfc_interleave< dim >::key( q );
+}
+
+template< unsigned dim >
+inline uint64_t hilbertKey( const uint32_t (&q)[dim] ) {
+    uint32_t x[dim];
+    for ( unsigned d = 0; d < dim; d++ )
+        x[d] = q[d];
+
+    // inverse undo of the excess work
+    const uint32_t M = uint32_t(1) << (SfcBits<dim>::value-1);
+    for ( uint32_t Q = M; Q > 1; Q >>= 1 ) {
+        const uint32_t P = Q-1;
+        for ( unsigned d = 0; d < dim; d++ )
+            if ( x[d] & Q ) {
+                x[0] ^= P;
+            } else {
+                const uint32_t t = (x[0] ^ x[d]) & P;
+                x[0] ^= t;
+                x[d] ^= t;
+            }
+    }
+
+    // gray encode
+    for ( unsigned d = 1; d < dim; d++ )
+        x[d] ^= x[d-1];
+    uint32_t t = 0;
+    for ( uint32_t Q = M; Q > 1; Q >>= 1 )
+        if ( x[dim-1] & Q ) t ^= Q-1;
+    for ( unsigned d = 0; d < dim; d++ )
+        x[d] ^= t;
+
+    return __functor_sfc_interleave< dim >::key( x );
+}
+
+//! key of x along the curve c through box, 0 for SpaceFillingCurve::None
+template< typename T, unsigned dim >
+inline uint64_t sfcKey( const SpaceFillingCurve c, const math::ShortVector< T, dim >& x, const BoundingBox< T, dim >& box ) {
+    uint32_t q[dim];
+    quantize( x, box, q );
+    switch ( c ) {
+        case SpaceFillingCurve::Morton:  return mortonKey< dim >( q );
+        case SpaceFillingCurve::Hilbert: return hilbertKey< dim >( q );
+        default:                         return 0;
+    }
+}
+
+
+
+//======= batches =======================================================================
+/**
+ * Permutation sorting a batch of points along the Morton curve through a box. Keys of
+ * bits per coordinate are sorted by a stable LSD radix sort with 8 bit digits, passes over
+ * digits that are equal for all points are skipped. The buffers are kept, so sorting
+ * batches of similar size does not allocate.
+ */
+template< typename T, unsigned dim >
+class MortonOrder {
+public:
+    static constexpr unsigned bits = SfcBits<dim>::value < 16 ? SfcBits<dim>::value : 16;
+
+protected:
+    std::vector< uint64_t > _key;
+    std::vector< uint64_t > _keyAux;
+    std::vector< unsigned > _order;
+    std::vector< unsigned > _orderAux;
+
+    void radixSort() {
+        const unsigned n = _key.size();
+        _keyAux.resize( n );
+        _orderAux.resize( n );
+
+        for ( unsigned shift = 0; shift < dim*bits; shift += 8 ) {
+            unsigned count[257] = { 0 };
+            for ( unsigned i = 0; i < n; i++ )
+                count[ ((_key[i] >> shift) & 0xFF) + 1 ]++;
+            if ( count[ ((_key[0] >> shift) & 0xFF) + 1 ] == n ) continue;
+
+            for ( unsigned d = 1; d < 257; d++ )
+                count[d] += count[d-1];
+            for ( unsigned i = 0; i < n; i++ ) {
+                const unsigned j = count[ (_key[i] >> shift) & 0xFF ]++;
+                _keyAux[j]   = _key[i];
+                _orderAux[j] = _order[i];
+            }
+            _key.swap( _keyAux );
+            _order.swap( _orderAux );
+        }
+    }
+
+public:
+    //! sort the points x, returns the indices of the points in curve order
+    const std::vector< unsigned >& operator () ( const math::ShortVectorArray< T, dim >& x, const BoundingBox< T, dim >& box ) {
+        const unsigned n = x.size();
+        _key.resize( n );
+        _order.resize( n );
+
+        uint32_t q[dim];
+        for ( unsigned i = 0; i < n; i++ ) {
+            quantize( x.get(i), box, q, bits );
+            _key[i]   = mortonKey< dim >( q );
+            _order[i] = i;
+        }
+        if ( n > 1 ) radixSort();
+        return _order;
+    }
+
+    //! identity permutation, for batches that are coherent already
+    const std::vector< unsigned >& identity( const unsigned n ) {
+        _order.resize( n );
+        for ( unsigned i = 0; i < n; i++ )
+            _order[i] = i;
+        return _order;
+    }
+
+    const std::vector< unsigned >& order() const { return _order; }
+};
+
+}
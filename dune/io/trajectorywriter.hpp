@@ -0,0 +1,278 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+/*! \file */
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <error/ioerror.hpp>
+#include <math/shortvector.hpp>
+#include <utils/utils.hpp>
+
+namespace io {
+
+/** @addtogroup IO
+ *
+ *  @{
+ */
+
+/*!***************************************************************************************
+ * @class TrajectoryWriter
+ * @brief Streaming writer for a single trajectory as VTK XML PolyData (.vtp).
+ *
+ * Samples are buffered in chunks of fixed size. Each full chunk is appended to temporary
+ * block files for positions, times and polyline connectivity, zlib compressed if requested
+ * and available (HAVE_ZLIB). close() writes the XML header and copies the blocks into the
+ * appended data section, so memory is bounded by the chunk size independent of the run
+ * length. The samples share their points and form a single polyline. In 2D the time,
+ * multiplied by timeScale, is used as third coordinate.
+ *****************************************************************************************/
+template< typename BT, unsigned dim >
+class TrajectoryWriter {
+protected:
+    struct BlockFile {
+        std::string             path;
+        std::fstream            file;
+        std::vector<uint64_t>   sizes;          //!> stored size of every block
+        uint64_t                bytes;          //!> uncompressed bytes written
+
+        BlockFile() : bytes(0) {}
+    };
+
+    const std::string       _path;
+    const unsigned          _chunkSize;
+    const BT                _timeScale;
+    const bool              _compress;
+
+    std::vector<double>     _points;            //!> current chunk, 3 coordinates per sample
+    std::vector<double>     _times;             //!> current chunk
+    std::vector<int64_t>    _connectivity;      //!> current chunk
+    std::vector<char>       _buffer;            //!> compression / copy buffer
+
+    BlockFile               _blocks[3];         //!> points, times, connectivity
+    uint64_t                _size;              //!> number of samples
+    bool                    _open;
+
+    void open( BlockFile& bf, const std::string& suffix ) {
+        bf.path = _path + suffix;
+        bf.file.open( bf.path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !bf.file ) throw IOError( "Can not open " + bf.path, __ERROR_INFO__ );
+    }
+
+    void writeBlock( BlockFile& bf, const void* data, const uint64_t bytes ) {
+        if ( bytes == 0 ) return;
+        bf.bytes += bytes;
+
+#ifdef HAVE_ZLIB
+        if ( _compress ) {
+            uLongf csize = compressBound( bytes );
+            _buffer.resize( csize );
+            if ( compress2( reinterpret_cast<Bytef*>(_buffer.data()), &csize,
+                            reinterpret_cast<const Bytef*>(data), bytes, Z_DEFAULT_COMPRESSION ) != Z_OK )
+                throw IOError( "Compression failed for " + bf.path, __ERROR_INFO__ );
+            bf.file.write( _buffer.data(), csize );
+            bf.sizes.push_back( csize );
+            return;
+        }
+#endif
+        bf.file.write( reinterpret_cast<const char*>(data), bytes );
+        bf.sizes.push_back( bytes );
+    }
+
+    //! size of the appended block including its header
+    const uint64_t appendedSize( const BlockFile& bf ) const {
+        uint64_t s = 0;
+        for ( auto b : bf.sizes ) s += b;
+        return s + ( compressed() ? (3 + bf.sizes.size())*sizeof(uint64_t) : sizeof(uint64_t) );
+    }
+
+    void writeHeader( std::ostream& out, const BlockFile& bf, const uint64_t blockSize ) const {
+        if ( compressed() ) {
+            const uint64_t last = bf.sizes.empty() ? 0 : bf.bytes - (bf.sizes.size()-1)*blockSize;
+            const uint64_t head[3] = { bf.sizes.size(), blockSize, last };
+            out.write( reinterpret_cast<const char*>(head), sizeof(head) );
+            out.write( reinterpret_cast<const char*>(bf.sizes.data()), bf.sizes.size()*sizeof(uint64_t) );
+        } else
+            out.write( reinterpret_cast<const char*>(&bf.bytes), sizeof(uint64_t) );
+    }
+
+    void copy( std::ostream& out, BlockFile& bf ) {
+        bf.file.flush();
+        bf.file.seekg( 0 );
+        _buffer.resize( 1 << 20 );
+        while ( bf.file ) {
+            bf.file.read( _buffer.data(), _buffer.size() );
+            out.write( _buffer.data(), bf.file.gcount() );
+        }
+        bf.file.close();
+        std::remove( bf.path.c_str() );
+    }
+
+    //! write the current chunk to the block files, only full chunks and the last one,
+    //! the header of the compressed blocks assumes all but the last hold _chunkSize samples
+    void flush() {
+        writeBlock( _blocks[0], _points.data(),       _points.size()*sizeof(double) );
+        writeBlock( _blocks[1], _times.data(),        _times.size()*sizeof(double) );
+        writeBlock( _blocks[2], _connectivity.data(), _connectivity.size()*sizeof(int64_t) );
+        _points.clear();
+        _times.clear();
+        _connectivity.clear();
+    }
+
+public:
+    TrajectoryWriter( const std::string path, const unsigned chunkSize = 1 << 16, const BT timeScale = 1., const bool compress = false ) :
+        _path( path ),
+        _chunkSize( chunkSize ),
+        _timeScale( timeScale ),
+        _compress( compress ),
+        _size( 0 ),
+        _open( true )
+    {
+        static_assert( (dim == 2) || (dim == 3), "Trajectories can only be written in 2D and 3D!" );
+
+        _points.reserve( 3*_chunkSize );
+        _times.reserve( _chunkSize );
+        _connectivity.reserve( _chunkSize );
+
+        open( _blocks[0], ".points.tmp" );
+        open( _blocks[1], ".times.tmp" );
+        open( _blocks[2], ".connectivity.tmp" );
+    }
+
+    //! closes the file if close() was not called, errors are only reported, not thrown
+    ~TrajectoryWriter() {
+        if ( !_open ) return;
+        try {
+            close();
+        } catch ( ... ) {
+            std::cout << CE_ERROR << "Can not write trajectory " << _path << CE_RESET << std::endl;
+        }
+    }
+
+    //! true if the blocks are zlib compressed
+    const bool compressed() const {
+#ifdef HAVE_ZLIB
+        return _compress;
+#else
+        return false;
+#endif
+    }
+
+    const uint64_t size() const { return _size; }
+
+    void append( const math::ShortVector< BT, dim >& x, const BT t ) {
+        _points.push_back( x(0) );
+        _points.push_back( x(1) );
+        _points.push_back( (dim == 3) ? x(dim-1) : _timeScale*t );
+        _times.push_back( t );
+        _connectivity.push_back( _size++ );
+
+        if ( _times.size() == _chunkSize ) flush();
+    }
+
+    //! assemble the final .vtp file
+    void close() {
+        flush();
+        _open = false;
+
+        std::ofstream out( _path.c_str(), std::ios::binary | std::ios::trunc );
+        if ( !out ) throw IOError( "Can not open " + _path, __ERROR_INFO__ );
+
+        // the single polyline ends after the last point
+        const int64_t       offsets[1]  = { static_cast<int64_t>(_size) };
+        std::vector<char>   odata( reinterpret_cast<const char*>(offsets), reinterpret_cast<const char*>(offsets) + sizeof(offsets) );
+        BlockFile           obf;
+        if ( _size > 0 ) {
+            obf.bytes = sizeof(offsets);
+#ifdef HAVE_ZLIB
+            if ( _compress ) {
+                uLongf csize = compressBound( sizeof(offsets) );
+                odata.resize( csize );
+                if ( compress2( reinterpret_cast<Bytef*>(odata.data()), &csize, reinterpret_cast<const Bytef*>(offsets), sizeof(offsets), Z_DEFAULT_COMPRESSION ) != Z_OK )
+                    throw IOError( "Compression failed for " + _path, __ERROR_INFO__ );
+                odata.resize( csize );
+            }
+#endif
+            obf.sizes.push_back( odata.size() );
+        }
+
+        const uint64_t o0 = 0;
+        const uint64_t o1 = o0 + appendedSize( _blocks[1] );
+        const uint64_t o2 = o1 + appendedSize( _blocks[0] );
+        const uint64_t o3 = o2 + appendedSize( _blocks[2] );
+
+        out << "<?xml version=\"1.0\"?>\n";
+        out << "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\""
+            << ( compressed() ? " compressor=\"vtkZLibDataCompressor\"" : "" ) << ">\n";
+        out << "  <PolyData>\n";
+        out << "    <Piece NumberOfPoints=\"" << _size << "\" NumberOfVerts=\"0\" NumberOfLines=\"" << ( _size > 0 ? 1 : 0 )
+            << "\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n";
+        out << "      <PointData Scalars=\"time\">\n";
+        out << "        <DataArray type=\"Float64\" Name=\"time\" format=\"appended\" offset=\"" << o0 << "\"/>\n";
+        out << "      </PointData>\n";
+        out << "      <Points>\n";
+        out << "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << o1 << "\"/>\n";
+        out << "      </Points>\n";
+        out << "      <Lines>\n";
+        out << "        <DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"" << o2 << "\"/>\n";
+        out << "        <DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\"" << o3 << "\"/>\n";
+        out << "      </Lines>\n";
+        out << "    </Piece>\n";
+        out << "  </PolyData>\n";
+        out << "  <AppendedData encoding=\"raw\">\n   _";
+
+        writeHeader( out, _blocks[1], _chunkSize*sizeof(double) );
+        copy( out, _blocks[1] );
+        writeHeader( out, _blocks[0], 3*_chunkSize*sizeof(double) );
+        copy( out, _blocks[0] );
+        writeHeader( out, _blocks[2], _chunkSize*sizeof(int64_t) );
+        copy( out, _blocks[2] );
+        writeHeader( out, obf, sizeof(offsets) );
+        if ( _size > 0 )
+            out.write( odata.data(), odata.size() );
+
+        out << "\n  </AppendedData>\n";
+        out << "</VTKFile>\n";
+    }
+};
+
+/** @} */
+}
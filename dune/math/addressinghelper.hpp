@@ -57,15 +57,66 @@ inline const unsigned cmat_idx( const unsigned m, const unsigned n, const unsign
 
 
 
-template< int ... N, typename T >
-inline const int rten_idx( const TupleA< T, sizeof...(N) >& idx ) {
-    const int len[] = {N...};
+//======= compile time extents and strides ==============================================
+
+//! number of entries of a tensor with extents N...
+template< int ... N > struct ten_size;
+template<> struct ten_size<> { enum { value = 1 }; };
+template< int N0, int ... N > struct ten_size< N0, N... > { enum { value = N0*ten_size< N... >::value }; };
+
+//! extent of index K
+template< unsigned K, int ... N > struct ten_extent;
+template< int N0, int ... N > struct ten_extent< 0, N0, N... > { enum { value = N0 }; };
+template< unsigned K, int N0, int ... N > struct ten_extent< K, N0, N... > { enum { value = ten_extent< K-1, N... >::value }; };
+
+//! row-major stride of index K, the product of the extents behind it
+template< unsigned K, int ... N > struct rten_stride;
+template< int N0, int ... N > struct rten_stride< 0, N0, N... > { enum { value = ten_size< N... >::value }; };
+template< unsigned K, int N0, int ... N > struct rten_stride< K, N0, N... > { enum { value = rten_stride< K-1, N... >::value }; };
+
+//! column-major stride of index K, the product of the extents in front of it
+template< unsigned K, int ... N > struct cten_stride;
+template< int N0, int ... N > struct cten_stride< 0, N0, N... > { enum { value = 1 }; };
+template< unsigned K, int N0, int ... N > struct cten_stride< K, N0, N... > { enum { value = N0*cten_stride< K-1, N... >::value }; };
+
+//! row-major offset of the leading indices, missing trailing indices count as zero
+template< int ... N > struct __rten_offset {
+    static constexpr int eval() { return 0; }
+};
+
+template< int N0, int ... N > struct __rten_offset< N0, N... > {
+    static constexpr int eval() { return 0; }
+    template< typename ... I >
+    static constexpr int eval( const int i0, const I ... i ) { return i0*ten_size< N... >::value + __rten_offset< N... >::eval( i... ); }
+};
+
+//! column-major offset
+template< int ... N > struct __cten_offset {
+    static constexpr int eval() { return 0; }
+};
+
+template< int N0, int ... N > struct __cten_offset< N0, N... > {
+    template< typename ... I >
+    static constexpr int eval( const int i0, const I ... i ) { return i0 + N0*__cten_offset< N... >::eval( i... ); }
+};
+
+//! offsets of tuple indices, unrolled over the positions K
+template< unsigned K, unsigned D, int ... N > struct __ten_tuple {
+    template< typename T >
+    static inline int r( const TupleA< T, D >& idx ) { return idx(K)*rten_stride< K, N... >::value + __ten_tuple< K+1, D, N... >::r( idx ); }
+    template< typename T >
+    static inline int c( const TupleA< T, D >& idx ) { return idx(K)*cten_stride< K, N... >::value + __ten_tuple< K+1, D, N... >::c( idx ); }
+};
+
+template< unsigned D, int ... N > struct __ten_tuple< D, D, N... > {
+    template< typename T > static inline int r( const TupleA< T, D >& ) { return 0; }
+    template< typename T > static inline int c( const TupleA< T, D >& ) { return 0; }
+};
 
-    int l = idx(0);
-    for ( int k = 1; k < (int)sizeof...(N); k++ )
-        l = len[k]*l + idx(k);
 
-    return l;
+template< int ... N, typename T >
+inline const int rten_idx( const TupleA< T, sizeof...(N) >& idx ) {
+    return __ten_tuple< 0, sizeof...(N), N... >::r( idx );
 }
 
 template< int N0, typename T > inline const int rten_idx( const TupleA< T, 1 >& idx )
@@ -96,13 +147,7 @@ inline const int rten_idx( const TupleB< T >& idx, const int N ) {
 
 template< int ... N, typename T >
 inline const int cten_idx( const TupleA< T, sizeof...(N) >& idx ) {
-    const int len[] = {N...};
-
-    int l = idx(sizeof...(N)-1);
-    for ( int k = (int)sizeof...(N)-2; k >= 0; k--)
-        l = len[k]*l + idx(k);
-
-    return l;
+    return __ten_tuple< 0, sizeof...(N), N... >::c( idx );
 }
 
 template< int N0, typename T > inline const int cten_idx( const TupleA< T, 1 >& idx )
@@ -122,63 +167,47 @@ template< int N0, int N1, int N2, int N3, int N4, typename T > inline const int
 
 
 template< int ... N, typename ... types >
-inline const int rten_idx( const types ... i ) {
+constexpr inline const int rten_idx( const types ... i ) {
     static_assert( sizeof...(N) == sizeof...(types), "Invalid number of indices.");
-
-    const int idx[] = {static_cast<int>(i)...};
-    const int len[] = {static_cast<int>(N)...};
-
-    int l = idx[0];
-    for ( int k = 1; k < (int)sizeof...(i); k++ )
-        l = len[k]*l + idx[k];
-
-    return l;
+    return __rten_offset< N... >::eval( static_cast<int>(i)... );
 }
 
-template< int N0 > inline const int rten_idx( const int i0 )
+template< int N0 > constexpr inline const int rten_idx( const int i0 )
 { return i0; }
 
-template< int N0, int N1 > inline const int rten_idx( const int i0, const int i1 )
+template< int N0, int N1 > constexpr inline const int rten_idx( const int i0, const int i1 )
 { return i1 + N1*i0; }
 
-template< int N0, int N1, int N2 > inline const int rten_idx( const int i0, const int i1, const int i2 )
+template< int N0, int N1, int N2 > constexpr inline const int rten_idx( const int i0, const int i1, const int i2 )
 { return i2 + N2*(i1 + N1*i0); }
 
-template< int N0, int N1, int N2, int N3 > inline const int rten_idx( const int i0, const int i1, const int i2, const int i3 )
+template< int N0, int N1, int N2, int N3 > constexpr inline const int rten_idx( const int i0, const int i1, const int i2, const int i3 )
 { return i3 + N3*(i2 + N2*(i1 + N1*i0)); }
 
-template< int N0, int N1, int N2, int N3, int N4 > inline const int rten_idx( const int i0, const int i1, const int i2, const int i3, const int i4 )
+template< int N0, int N1, int N2, int N3, int N4 > constexpr inline const int rten_idx( const int i0, const int i1, const int i2, const int i3, const int i4 )
 { return i4 + N4*(i3 + N3*(i2 + N2*(i1 + N1*i0))); }
 
 
 
 template< int ... N, typename ... types >
-inline const int cten_idx( const types ... i ) {
+constexpr inline const int cten_idx( const types ... i ) {
     static_assert( sizeof...(N) == sizeof...(types), "Invalid number of indices.");
-
-    const int idx[] = {static_cast<int>(i)...};
-    const int len[] = {static_cast<int>(N)...};
-
-    int l = idx[sizeof...(i)-1];
-    for ( int k = (int)sizeof...(i)-2; k >= 0; k--)
-        l = len[k]*l + idx[k];
-
-    return l;
+    return __cten_offset< N... >::eval( static_cast<int>(i)... );
 }
 
-template< int N0 > inline const int cten_idx( const int i0 )
+template< int N0 > constexpr inline const int cten_idx( const int i0 )
 { return i0; }
 
-template< int N0, int N1 > inline const int cten_idx( const int i0, const int i1 )
+template< int N0, int N1 > constexpr inline const int cten_idx( const int i0, const int i1 )
 { return i0 + N0*i1; }
 
-template< int N0, int N1, int N2 > inline const int cten_idx( const int i0, const int i1, const int i2 )
-{ return i0 + N0*(i1 + N1*i0); }
+template< int N0, int N1, int N2 > constexpr inline const int cten_idx( const int i0, const int i1, const int i2 )
+{ return i0 + N0*(i1 + N1*i2); }
 
-template< int N0, int N1, int N2, int N3 > inline const int cten_idx( const int i0, const int i1, const int i2, const int i3 )
+template< int N0, int N1, int N2, int N3 > constexpr inline const int cten_idx( const int i0, const int i1, const int i2, const int i3 )
 { return i0 + N0*(i1 + N1*(i2 + N2*i3)); }
 
-template< int N0, int N1, int N2, int N3, int N4 > inline const int cten_idx( const int i0, const int i1, const int i2, const int i3, const int i4 )
+template< int N0, int N1, int N2, int N3, int N4 > constexpr inline const int cten_idx( const int i0, const int i1, const int i2, const int i3, const int i4 )
 { return i0 + N0*(i1 + N1*(i2 + N2*(i3 + N3*i4))); }
 
 /** @} */
@@ -35,10 +35,10 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <type_traits>
 
 #include <error/matherror.hpp>
 #include <math/smallmatrix.hpp>
-#include <utils/fastmemcpy.h>
 
 extern "C" {
 #include <emmintrin.h>
@@ -56,36 +56,300 @@ namespace math {
  *  @{
  */
 
+//======= storage layout ================================================================
+// All vectors store exactly N components, so vectors kept in large containers (bounding
+// boxes, vertex and cell containers) do not grow. Vectors of float/double with N = 2,3,4
+// are widened to a full SSE/AVX register of lanes components on load, the extra lanes are
+// zero, and narrowed again on store. Vectors filling 16 or 32 bytes are 16 byte aligned.
+
+template< typename T, unsigned N >
+struct __ShortVector_layout {
+    enum { lanes = N, align = alignof(T), simd = 0 };
+};
+
+template<> struct __ShortVector_layout< double, 2 > { enum { lanes = 2, align = 16, simd = 1 }; };
+template<> struct __ShortVector_layout< double, 3 > { enum { lanes = 4, align =  8, simd = 1 }; };
+template<> struct __ShortVector_layout< double, 4 > { enum { lanes = 4, align = 16, simd = 1 }; };
+template<> struct __ShortVector_layout< float,  2 > { enum { lanes = 4, align =  8, simd = 1 }; };
+template<> struct __ShortVector_layout< float,  3 > { enum { lanes = 4, align =  4, simd = 1 }; };
+template<> struct __ShortVector_layout< float,  4 > { enum { lanes = 4, align = 16, simd = 1 }; };
+
+
+//======= SIMD registers ================================================================
+// One register of P lanes. load<S> and store<S> move the S stored components of a vector,
+// load zeroes the remaining lanes. gather<M> loads M strided components (a matrix column)
+// and zeroes the rest.
+
+template< typename T, unsigned P >
+struct __ShortVector_lanes;
+
+template<> struct __ShortVector_lanes< double, 2 > {
+    typedef __m128d R;
+    template< unsigned S >
+    static inline R      load ( const double* a )          { return _mm_load_pd( a ); }
+    template< unsigned S >
+    static inline void   store( double* a, const R r )     { _mm_store_pd( a, r ); }
+    static inline R      set1 ( const double s )           { return _mm_set1_pd( s ); }
+    static inline R      add  ( const R a, const R b )     { return _mm_add_pd( a, b ); }
+    static inline R      sub  ( const R a, const R b )     { return _mm_sub_pd( a, b ); }
+    static inline R      mul  ( const R a, const R b )     { return _mm_mul_pd( a, b ); }
+    static inline double hsum ( const R a )                { return _mm_cvtsd_f64( _mm_add_sd( a, _mm_unpackhi_pd( a, a ) ) ); }
+    template< unsigned M >
+    static inline R      gather( const double* a, const unsigned s ) { return _mm_set_pd( M > 1 ? a[s] : 0., a[0] ); }
+};
+
+#ifdef __AVX__
+template<> struct __ShortVector_lanes< double, 4 > {
+    typedef __m256d R;
+    // 32 byte alignment is not guaranteed by the allocators before C++17
+    template< unsigned S >
+    static inline R      load ( const double* a ) {
+        return ( S == 4 ) ? _mm256_loadu_pd( a )
+                          : _mm256_insertf128_pd( _mm256_castpd128_pd256( _mm_loadu_pd( a ) ), _mm_load_sd( a+2 ), 1 );
+    }
+    template< unsigned S >
+    static inline void   store( double* a, const R r ) {
+        if ( S == 4 ) { _mm256_storeu_pd( a, r ); return; }
+        _mm_storeu_pd( a, _mm256_castpd256_pd128( r ) );
+        _mm_store_sd( a+2, _mm256_extractf128_pd( r, 1 ) );
+    }
+    static inline R      set1 ( const double s )           { return _mm256_set1_pd( s ); }
+    static inline R      add  ( const R a, const R b )     { return _mm256_add_pd( a, b ); }
+    static inline R      sub  ( const R a, const R b )     { return _mm256_sub_pd( a, b ); }
+    static inline R      mul  ( const R a, const R b )     { return _mm256_mul_pd( a, b ); }
+    static inline double hsum ( const R a ) {
+        const __m128d s = _mm_add_pd( _mm256_castpd256_pd128( a ), _mm256_extractf128_pd( a, 1 ) );
+        return _mm_cvtsd_f64( _mm_add_sd( s, _mm_unpackhi_pd( s, s ) ) );
+    }
+    template< unsigned M >
+    static inline R      gather( const double* a, const unsigned s ) {
+        return _mm256_set_pd( M > 3 ? a[3*s] : 0., M > 2 ? a[2*s] : 0., M > 1 ? a[s] : 0., a[0] );
+    }
+};
+#else
+template<> struct __ShortVector_lanes< double, 4 > {
+    struct R { __m128d lo, hi; };
+    template< unsigned S >
+    static inline R      load ( const double* a )          { return R{ _mm_loadu_pd( a ), ( S == 4 ) ? _mm_loadu_pd( a+2 ) : _mm_load_sd( a+2 ) }; }
+    template< unsigned S >
+    static inline void   store( double* a, const R r ) {
+        _mm_storeu_pd( a, r.lo );
+        if ( S == 4 ) _mm_storeu_pd( a+2, r.hi );
+        else          _mm_store_sd( a+2, r.hi );
+    }
+    static inline R      set1 ( const double s )           { return R{ _mm_set1_pd( s ), _mm_set1_pd( s ) }; }
+    static inline R      add  ( const R a, const R b )     { return R{ _mm_add_pd( a.lo, b.lo ), _mm_add_pd( a.hi, b.hi ) }; }
+    static inline R      sub  ( const R a, const R b )     { return R{ _mm_sub_pd( a.lo, b.lo ), _mm_sub_pd( a.hi, b.hi ) }; }
+    static inline R      mul  ( const R a, const R b )     { return R{ _mm_mul_pd( a.lo, b.lo ), _mm_mul_pd( a.hi, b.hi ) }; }
+    static inline double hsum ( const R a ) {
+        const __m128d s = _mm_add_pd( a.lo, a.hi );
+        return _mm_cvtsd_f64( _mm_add_sd( s, _mm_unpackhi_pd( s, s ) ) );
+    }
+    template< unsigned M >
+    static inline R      gather( const double* a, const unsigned s ) {
+        return R{ _mm_set_pd( M > 1 ? a[s] : 0., a[0] ), _mm_set_pd( M > 3 ? a[3*s] : 0., M > 2 ? a[2*s] : 0. ) };
+    }
+};
+#endif
+
+template<> struct __ShortVector_lanes< float, 4 > {
+    typedef __m128 R;
+    template< unsigned S >
+    static inline R      load ( const float* a ) {
+        if ( S == 4 ) return _mm_load_ps( a );
+        const R lo = _mm_loadl_pi( _mm_setzero_ps(), reinterpret_cast< const __m64* >( a ) );
+        return ( S == 3 ) ? _mm_movelh_ps( lo, _mm_load_ss( a+2 ) ) : lo;
+    }
+    template< unsigned S >
+    static inline void   store( float* a, const R r ) {
+        if ( S == 4 ) { _mm_store_ps( a, r ); return; }
+        _mm_storel_pi( reinterpret_cast< __m64* >( a ), r );
+        if ( S == 3 ) _mm_store_ss( a+2, _mm_movehl_ps( r, r ) );
+    }
+    static inline R      set1 ( const float s )            { return _mm_set1_ps( s ); }
+    static inline R      add  ( const R a, const R b )     { return _mm_add_ps( a, b ); }
+    static inline R      sub  ( const R a, const R b )     { return _mm_sub_ps( a, b ); }
+    static inline R      mul  ( const R a, const R b )     { return _mm_mul_ps( a, b ); }
+    static inline float  hsum ( const R a ) {
+        const __m128 s = _mm_add_ps( a, _mm_movehl_ps( a, a ) );
+        return _mm_cvtss_f32( _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) ) );
+    }
+    template< unsigned M >
+    static inline R      gather( const float* a, const unsigned s ) {
+        return _mm_set_ps( M > 3 ? a[3*s] : 0.f, M > 2 ? a[2*s] : 0.f, M > 1 ? a[s] : 0.f, a[0] );
+    }
+};
+
+
+//======= expression templates ==========================================================
+// Sums, differences and scalar multiples of vectors are not evaluated on construction but
+// build a tree of expression nodes, which is evaluated component wise (or register wise
+// for the SIMD types) on assignment. A compound expression thus compiles to a single
+// loop without temporaries. Nodes refer to their ShortVector leaves by reference, so an
+// expression must not outlive the vectors it was built from, i.e. do not store it in an
+// auto variable.
+
+template< typename T, unsigned N >
+struct ShortVector;
+
+//! base of all vector expressions, E is the derived node type
+template< class E, typename T, unsigned N >
+struct __ShortVector_expr {
+    inline const E& self() const { return static_cast< const E& >( *this ); }
+};
+
+//! nodes hold sub expressions by value and vectors by reference
+template< class E >
+struct __ShortVector_operand { typedef const E type; };
+
+template< typename T, unsigned N >
+struct __ShortVector_operand< ShortVector< T, N > > { typedef const ShortVector< T, N >& type; };
+
+template< class A, class B, typename T, unsigned N >
+struct __ShortVector_sum : public __ShortVector_expr< __ShortVector_sum< A, B, T, N >, T, N > {
+    typename __ShortVector_operand< A >::type a;
+    typename __ShortVector_operand< B >::type b;
+
+    __ShortVector_sum( const A& a_, const B& b_ ) : a( a_ ), b( b_ ) {}
+
+    inline T at( const unsigned k ) const { return a.at( k ) + b.at( k ); }
+    template< class L >
+    inline typename L::R lanes() const { return L::add( a.template lanes< L >(), b.template lanes< L >() ); }
+};
+
+template< class A, class B, typename T, unsigned N >
+struct __ShortVector_diff : public __ShortVector_expr< __ShortVector_diff< A, B, T, N >, T, N > {
+    typename __ShortVector_operand< A >::type a;
+    typename __ShortVector_operand< B >::type b;
+
+    __ShortVector_diff( const A& a_, const B& b_ ) : a( a_ ), b( b_ ) {}
+
+    inline T at( const unsigned k ) const { return a.at( k ) - b.at( k ); }
+    template< class L >
+    inline typename L::R lanes() const { return L::sub( a.template lanes< L >(), b.template lanes< L >() ); }
+};
+
+template< class A, typename T, unsigned N >
+struct __ShortVector_scaled : public __ShortVector_expr< __ShortVector_scaled< A, T, N >, T, N > {
+    const T                                 s;
+    typename __ShortVector_operand< A >::type a;
+
+    __ShortVector_scaled( const T s_, const A& a_ ) : s( s_ ), a( a_ ) {}
+
+    inline T at( const unsigned k ) const { return s*a.at( k ); }
+    template< class L >
+    inline typename L::R lanes() const { return L::mul( L::set1( s ), a.template lanes< L >() ); }
+};
+
+
+//! matrix vector product, x is evaluated on construction so it may alias the result
+template< class E, typename T, unsigned M, unsigned N >
+struct __ShortVector_matvec : public __ShortVector_expr< __ShortVector_matvec< E, T, M, N >, T, M > {
+    const SmallMatrix< T, M, N >&   A;
+    const ShortVector< T, N >       x;
+
+    __ShortVector_matvec( const SmallMatrix< T, M, N >& A_, const E& x_ ) : A( A_ ), x( x_ ) {}
+
+    inline T at( const unsigned m ) const {
+        T c = A.data[rmat_idx<M,N>(m,0)]*x.data[0];
+        for ( unsigned n = 1; n < N; n++ )
+            c += A.data[rmat_idx<M,N>(m,n)]*x.data[n];
+        return c;
+    }
+    template< class L >
+    inline typename L::R lanes() const {
+        typename L::R c = L::mul( L::set1( x.data[0] ), L::template gather< M >( A.data, N ) );
+        for ( unsigned n = 1; n < N; n++ )
+            c = L::add( c, L::mul( L::set1( x.data[n] ), L::template gather< M >( A.data + n, N ) ) );
+        return c;
+    }
+};
+
+
+//======= evaluation ====================================================================
+// The generic version works on the N components, the SIMD one on whole registers. The
+// lanes beyond N stay zero as all nodes are linear and are dropped on store.
+
+template< typename T, unsigned N, bool simd = __ShortVector_layout<T,N>::simd >
+struct __functor_ShortVector {
+    template< class E >
+    static inline void assign( T* c, const E& e ) {
+        for ( unsigned k = 0; k < N; k++ )
+            c[k] = e.at( k );
+    }
+
+    template< class A, class B >
+    static inline T dot( const A& a, const B& b ) {
+        T c = a.at( 0 )*b.at( 0 );
+        for ( unsigned k = 1; k < N; k++ )
+            c += a.at( k )*b.at( k );
+        return c;
+    }
+};
+
+template< typename T, unsigned N >
+struct __functor_ShortVector< T, N, true > {
+    typedef __ShortVector_lanes< T, __ShortVector_layout<T,N>::lanes > L;
+
+    template< class E >
+    static inline void assign( T* c, const E& e ) { L::template store< N >( c, e.template lanes< L >() ); }
+
+    template< class A, class B >
+    static inline T dot( const A& a, const B& b ) { return L::hsum( L::mul( a.template lanes< L >(), b.template lanes< L >() ) ); }
+};
+
+//! true iff all types are arithmetic, restricts the component wise constructor
+template< typename ... _T >
+struct __ShortVector_scalars { enum { value = 1 }; };
+
+template< typename _T0, typename ... _T >
+struct __ShortVector_scalars< _T0, _T ... > {
+    enum { value = std::is_arithmetic< _T0 >::value && __ShortVector_scalars< _T ... >::value };
+};
+
+
 /*!***************************************************************************************
  * @class ShortVector
  * @brief Plain representation of a math vector
  *
+ * Trivially copyable, stores exactly N components. For float/double with N = 2,3,4 the
+ * arithmetic runs on SIMD registers, see __ShortVector_layout.
+ *
  * @url http://en.wikipedia.org/wiki/Euclidean_vector
  *****************************************************************************************/
 template< typename T, unsigned N >
-struct ShortVector {
-    T data[N];
+struct ShortVector : public __ShortVector_expr< ShortVector< T, N >, T, N > {
+    static constexpr unsigned size = N;                                 //!< number of stored components
+
+    alignas( __ShortVector_layout<T,N>::align ) T data[size];
 
     /*!***************************************************************************************
     * Contruct and initialize with zero iff SHORT_VECTOR_INIT_ZERO is defined.
     *****************************************************************************************/
     ShortVector() {
         #ifdef SHORT_VECTOR_INIT_ZERO
-        memset( data, 0, sizeof(T)*N );
+        for ( unsigned k = 0; k < size; k++ )
+            data[k] = static_cast<T>(0.);
         #endif
     }
 
     /*!***************************************************************************************
     * Copy-Contruct.
     *****************************************************************************************/
-    ShortVector( const ShortVector< T, N >& rhs ) {
-        fast_memcpy( data, rhs.data, sizeof(T)*N );
+    ShortVector( const ShortVector< T, N >& rhs ) = default;
+
+    /*!***************************************************************************************
+    * Contruct by evaluating a vector expression.
+    *****************************************************************************************/
+    template< class E >
+    ShortVector( const __ShortVector_expr< E, T, N >& rhs ) {
+        __functor_ShortVector< T, N >::assign( data, rhs.self() );
     }
 
     /*!***************************************************************************************
     * Contruct from one or N scalars.
     *****************************************************************************************/
-    template< typename ... _T >
+    template< typename ... _T, typename = typename std::enable_if< __ShortVector_scalars< _T ... >::value >::type >
     ShortVector( const _T ... in ) {
         static_assert( (N == sizeof...(in)) || (1 == sizeof...(in)), "Invalid number of arguments in constructor");
 
@@ -108,6 +372,13 @@ struct ShortVector {
     *****************************************************************************************/
     inline const T& operator()( const unsigned k ) const { return data[k]; }
 
+    /*!***************************************************************************************
+    * Leaf evaluation of expressions.
+    *****************************************************************************************/
+    inline T at( const unsigned k ) const { return data[k]; }
+    template< class L >
+    inline typename L::R lanes() const { return L::template load< N >( data ); }
+
     /*!***************************************************************************************
     * Assign the same scalar right hand side to each component.
     *****************************************************************************************/
@@ -120,34 +391,32 @@ struct ShortVector {
     /*!***************************************************************************************
     * Assign an other ShortVector.
     *****************************************************************************************/
-    inline const ShortVector< T, N >& operator = ( const ShortVector< T, N >& rhs ) {
-        fast_memcpy( data, rhs.data, sizeof(T)*N );
+    inline ShortVector< T, N >& operator = ( const ShortVector< T, N >& rhs ) = default;
+
+    /*!***************************************************************************************
+    * Assign a vector expression, which may contain this vector.
+    *****************************************************************************************/
+    template< class E >
+    inline const ShortVector< T, N >& operator = ( const __ShortVector_expr< E, T, N >& rhs ) {
+        __functor_ShortVector< T, N >::assign( data, rhs.self() );
         return *this;
     }
 
-//     /*!***************************************************************************************
-//     * Assign a \f$N\times 1\f$ Matrix.
-//     *****************************************************************************************/
-//     inline const ShortVector< T, N >& operator = ( const SmallMatrix< T, N, 1 >& rhs ) {
-//         fast_memcpy( data, rhs.data, sizeof(T)*N );
-//         return *this;
-//     }
-
     /*!***************************************************************************************
     * Vector sum in place.
     *****************************************************************************************/
-    inline const ShortVector< T, N >& operator += ( const ShortVector< T, N >& rhs ) {
-        for ( unsigned k = 0; k < N; k++ )
-            data[k] += rhs.data[k];
+    template< class E >
+    inline const ShortVector< T, N >& operator += ( const __ShortVector_expr< E, T, N >& rhs ) {
+        __functor_ShortVector< T, N >::assign( data, __ShortVector_sum< ShortVector< T, N >, E, T, N >( *this, rhs.self() ) );
         return *this;
     }
 
     /*!***************************************************************************************
     * Vector difference in place.
     *****************************************************************************************/
-    inline const ShortVector< T, N >& operator -= ( const ShortVector< T, N >& rhs ) {
-        for ( unsigned k = 0; k < N; k++ )
-            data[k] += rhs.data[k];
+    template< class E >
+    inline const ShortVector< T, N >& operator -= ( const __ShortVector_expr< E, T, N >& rhs ) {
+        __functor_ShortVector< T, N >::assign( data, __ShortVector_diff< ShortVector< T, N >, E, T, N >( *this, rhs.self() ) );
         return *this;
     }
 
@@ -155,8 +424,7 @@ struct ShortVector {
     * Multiply every component in place by a scalar right hand side.
     *****************************************************************************************/
     inline const ShortVector< T, N >& operator *= ( const T rhs ) {
-        for ( unsigned k = 0; k < N; k++ )
-            data[k] *= rhs;
+        __functor_ShortVector< T, N >::assign( data, __ShortVector_scaled< ShortVector< T, N >, T, N >( rhs, *this ) );
         return *this;
     }
 
@@ -164,194 +432,168 @@ struct ShortVector {
     * Devide every component in place by a scalar right hand side.
     *****************************************************************************************/
     inline const ShortVector< T, N >& operator /= ( const T rhs ) {
-        const T aux = static_cast<T>(1.)/rhs;
-        for ( unsigned k = 0; k < N; k++ )
-            data[k] *= aux;
+        __functor_ShortVector< T, N >::assign( data, __ShortVector_scaled< ShortVector< T, N >, T, N >( static_cast<T>(1.)/rhs, *this ) );
         return *this;
     }
 };
 
-// template< unsigned N >
-// struct ShortVector<float, N> {
-//     const unsigned size;
-//     __m128 data[((N%4) ? (N + 4 - N%4) : (N))/4];
-//
-//     /*!***************************************************************************************
-//     * Contruct and initialize with zero iff SHORT_VECTOR_INIT_ZERO is defined.
-//     *****************************************************************************************/
-//     ShortVector() : size(((N%4) ? (N + 4 - N%4) : (N))/4) {
-//         const __m128 aux = _mm_set_ps(0.f, 0.f, 0.f, 0.f);
-//         for ( unsigned k = 0; k < size; k++ )
-//             data[k] = aux;
-//     }
-//
-//     /*!***************************************************************************************
-//     * Copy-Contruct.
-//     *****************************************************************************************/
-//     ShortVector( const ShortVector< float, N >& rhs ) : size(((N%4) ? (N + 4 - N%4) : (N))/4) {
-//         for ( unsigned k = 0; k < size; k++ )
-//             data[k] = rhs.data[k];
-//     }
-//
-//     /*!***************************************************************************************
-//     * Contruct from one or N scalars.
-//     *****************************************************************************************/
-//     template< typename ... _T >
-//     ShortVector( const _T ... in ) : size(((N%4) ? (N + 4 - N%4) : (N))/4) {
-//         static_assert( (N == sizeof...(in)) || (1 == sizeof...(in)), "Invalid number of arguments in constructor");
-//
-//         const __m128 aux = _mm_set_ps(0.f, 0.f, 0.f, 0.f);
-//         for ( unsigned k = 0; k < size; k++ )
-//             data[k] = aux;
-//
-//         float val [] = { static_cast<float>( in ) ... };
-//
-//         if ( N == sizeof...(in) )
-//             for ( unsigned k = 0; k < N; k++ )
-//                 reinterpret_cast<float*>(data)[k] = val[k];
-//         else
-//             for ( unsigned k = 0; k < N; k++ )
-//                 reinterpret_cast<float*>(data)[k] = val[0];
-//
-//     }
-//
-//     /*!***************************************************************************************
-//     * Access k-th component by reference.
-//     *****************************************************************************************/
-//     inline float& operator () ( const unsigned k ) { return reinterpret_cast<float*>(data)[k]; }
-//     /*!***************************************************************************************
-//     * Access k-th component by constant reference.
-//     *****************************************************************************************/
-//     inline const float& operator()( const unsigned k ) const { return reinterpret_cast<float*>(data)[k]; }
-//
-//     /*!***************************************************************************************
-//     * Assign the same scalar right hand side to each component.
-//     *****************************************************************************************/
-//     inline const ShortVector< float, N >& operator = ( const float rhs ) {
-//         const __m128 aux = _mm_set_ps(rhs, rhs, rhs, rhs);
-//         for ( unsigned k = 0; k < size; k++ )
-//             data[k] = aux;
-//         return *this;
-//     }
-//
-//     /*!***************************************************************************************
-//     * Assign an other ShortVector.
-//     *****************************************************************************************/
-//     inline const ShortVector< float, N >& operator = ( const ShortVector< float, N >& rhs ) {
-//         fast_memcpy( data, rhs.data, sizeof(__m128)*size );
-//         return *this;
-//     }
-//
-//     /*!***************************************************************************************
-//     * Devide every component in place by a scalar right hand side.
-//     *****************************************************************************************/
-//     inline const ShortVector< float, N >& operator /= ( const float rhs ) {
-//         const float  aux0 = 1.f/rhs;
-//         const __m128 aux1 = _mm_set_ps(aux0, aux0, aux0, aux0);
-//         for ( unsigned k = 0; k < size; k++ )
-//             data[k] = _mm_mul_ps(data[k], aux1);
-//         return *this;
-//     }
-// };
+template< typename T, unsigned N >
+constexpr unsigned ShortVector< T, N >::size;
 
 /*!***************************************************************************************
  * Vector sum \f$A+B\f$.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > operator + ( const ShortVector< T, N >& A, const ShortVector< T, N >& B ) {
-    ShortVector< T, N > C;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = A.data[k] + B.data[k];
-    return C;
+template< class A, class B, typename T, unsigned N >
+inline const __ShortVector_sum< A, B, T, N > operator + ( const __ShortVector_expr< A, T, N >& a, const __ShortVector_expr< B, T, N >& b ) {
+    return __ShortVector_sum< A, B, T, N >( a.self(), b.self() );
 }
 
 /*!***************************************************************************************
  * Vector difference \f$A-B\f$.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > operator - ( const ShortVector< T, N >& A, const ShortVector< T, N >& B ) {
-    ShortVector< T, N > C;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = A.data[k] - B.data[k];
-    return C;
+template< class A, class B, typename T, unsigned N >
+inline const __ShortVector_diff< A, B, T, N > operator - ( const __ShortVector_expr< A, T, N >& a, const __ShortVector_expr< B, T, N >& b ) {
+    return __ShortVector_diff< A, B, T, N >( a.self(), b.self() );
 }
 
 /*!***************************************************************************************
  * Multiply A by \f$-1\f$.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > operator - ( const ShortVector< T, N >& A ) {
-    ShortVector< T, N > C;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = -A.data[k];
-    return C;
+template< class A, typename T, unsigned N >
+inline const __ShortVector_scaled< A, T, N > operator - ( const __ShortVector_expr< A, T, N >& a ) {
+    return __ShortVector_scaled< A, T, N >( static_cast<T>(-1.), a.self() );
 }
 
 /*!***************************************************************************************
  * Multiply every component of B by a scalar A.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > operator * ( const T A, const ShortVector< T, N >& B ) {
-    ShortVector< T, N > C;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = A*B.data[k];
-    return C;
+template< class B, typename T, unsigned N >
+inline const __ShortVector_scaled< B, T, N > operator * ( const T A, const __ShortVector_expr< B, T, N >& b ) {
+    return __ShortVector_scaled< B, T, N >( A, b.self() );
 }
 
 /*!***************************************************************************************
  * Multiply every component of A by a scalar B.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > operator * ( const ShortVector< T, N >& A, const T B ) {
-    ShortVector< T, N > C;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = A.data[k]*B;
-    return C;
+template< class A, typename T, unsigned N >
+inline const __ShortVector_scaled< A, T, N > operator * ( const __ShortVector_expr< A, T, N >& a, const T B ) {
+    return __ShortVector_scaled< A, T, N >( B, a.self() );
 }
 
 /*!***************************************************************************************
  * Devide every component of A by a scalar B.
  *****************************************************************************************/
+template< class A, typename T, unsigned N >
+inline const __ShortVector_scaled< A, T, N > operator / ( const __ShortVector_expr< A, T, N >& a, const T B ) {
+    return __ShortVector_scaled< A, T, N >( static_cast<T>(1.)/B, a.self() );
+}
+
+/*!***************************************************************************************
+ * \f$ Y \leftarrow Y + aX \f$ without temporaries.
+ *****************************************************************************************/
+template< class E, typename T, unsigned N >
+inline void axpy( ShortVector< T, N >& Y, const T a, const __ShortVector_expr< E, T, N >& X ) {
+    Y += a*X;
+}
+
+/*!***************************************************************************************
+ * Matrix vector product \f$ y_m = \sum_n\, A_{mn} x_n \f$.
+ *****************************************************************************************/
+template< typename T, unsigned M, unsigned N, class E >
+inline const __ShortVector_matvec< E, T, M, N > operator * ( const SmallMatrix< T, M, N >& A, const __ShortVector_expr< E, T, N >& x ) {
+    return __ShortVector_matvec< E, T, M, N >( A, x.self() );
+}
+
+/*!***************************************************************************************
+ * Solve \f$ A x = b \f$ with a regular LU factorization of A.
+ *****************************************************************************************/
 template< typename T, unsigned N >
-inline const ShortVector< T, N > operator / ( const ShortVector< T, N >& A, const T B ) {
-    ShortVector< T, N > C;
-    const T aux = static_cast<T>(1.)/B;
-    for ( unsigned k = 0; k < N; k++ )
-        C.data[k] = A.data[k]*aux;
-    return C;
+inline const ShortVector< T, N > solve( const SmallLU< T, N >& F, const ShortVector< T, N >& b ) {
+    ShortVector< T, N > x;
+    for ( unsigned i = 0; i < N; i++ ) {
+        T s = b.data[F.piv[i]];
+        for ( unsigned j = 0; j < i; j++ )
+            s -= F.lu(i,j)*x.data[j];
+        x.data[i] = s;
+    }
+    for ( unsigned i = N; i-- > 0; ) {
+        T s = x.data[i];
+        for ( unsigned j = i+1; j < N; j++ )
+            s -= F.lu(i,j)*x.data[j];
+        x.data[i] = s/F.lu(i,i);
+    }
+    return x;
 }
 
 /*!***************************************************************************************
- * Scalar product \f$ \left<\cdot,\cdot\right> : \{a, b\}\in R^n \times R^n \rightarrow c\in R, \quad c = \sum_k\, a_k b_k \f$
+ * Solve \f$ A x = b \f$ with a regular Cholesky factorization of A.
  *****************************************************************************************/
 template< typename T, unsigned N >
-inline const T dot( const ShortVector< T, N >& A, const ShortVector< T, N >& B ) {
-    T C = A.data[0]*B.data[0];
-    for ( unsigned k = 1; k < N; k++ )
-        C += A.data[k]*B.data[k];
-    return C;
+inline const ShortVector< T, N > solve( const SmallCholesky< T, N >& F, const ShortVector< T, N >& b ) {
+    ShortVector< T, N > x;
+    for ( unsigned i = 0; i < N; i++ ) {
+        T s = b.data[i];
+        for ( unsigned j = 0; j < i; j++ )
+            s -= F.L(i,j)*x.data[j];
+        x.data[i] = s/F.L(i,i);
+    }
+    for ( unsigned i = N; i-- > 0; ) {
+        T s = x.data[i];
+        for ( unsigned j = i+1; j < N; j++ )
+            s -= F.L(j,i)*x.data[j];
+        x.data[i] = s/F.L(i,i);
+    }
+    return x;
 }
 
-///*!***************************************************************************************
-// * Scalar product (float) \f$ \left<\cdot,\cdot\right> : \{a, b\}\in R^n \times R^n \rightarrow c\in R, \quad c = \sum_k\, a_k b_k \f$
-// *****************************************************************************************/
-// template< unsigned N >
-// inline const float dot( const ShortVector< float, N >& A, const ShortVector< float, N >& B ) {
-//     const __m128 aux = _mm_set_ps(0.f, 0.f, 0.f, 0.f);
-//
-//
-//     for ( unsigned k = 0; k < A.size; k++ )
-//         aux = _mm_add_ps( aux,  _mm_add_ps( A.data[k], B.data[k] ));
-//
-//     const float* C = reinterpret_cast<const float*>(aux);
-//     return C[0]+C[0]+C[0]+C[0];
-// }
+/*!***************************************************************************************
+ * Solve \f$ A x = b \f$, closed form inverse for N <= 3 and LU otherwise. Returns false
+ * and leaves x unchanged if A is singular.
+ *****************************************************************************************/
+template< typename T, unsigned N >
+inline const bool solve( const SmallMatrix< T, N, N >& A, const ShortVector< T, N >& b, ShortVector< T, N >& x ) {
+    if ( N <= 3 ) {
+        SmallMatrix< T, N, N > C;
+        if ( !invert( A, C ) ) return false;
+        x = C*b;
+    } else {
+        SmallLU< T, N > F;
+        if ( !lu( A, F ) ) return false;
+        x = solve( F, b );
+    }
+    return true;
+}
+
+/*!***************************************************************************************
+ * Solve n systems \f$ A_k x_k = b_k \f$, regular[k] (if given) tells whether A_k was
+ * invertible. Returns the number of singular systems.
+ *****************************************************************************************/
+template< typename T, unsigned N >
+inline const unsigned solve( const SmallMatrix< T, N, N >* A, const ShortVector< T, N >* b, ShortVector< T, N >* x,
+                             const unsigned n, bool* regular = NULL ) {
+    unsigned singular = 0;
+    for ( unsigned k = 0; k < n; k++ ) {
+        const bool ok = solve( A[k], b[k], x[k] );
+        if ( regular ) regular[k] = ok;
+        if ( !ok ) singular++;
+    }
+    return singular;
+}
+
+/*!***************************************************************************************
+ * Scalar product \f$ \left<\cdot,\cdot\right> : \{a, b\}\in R^n \times R^n \rightarrow c\in R, \quad c = \sum_k\, a_k b_k \f$
+ *****************************************************************************************/
+template< class A, class B, typename T, unsigned N >
+inline const T dot( const __ShortVector_expr< A, T, N >& a, const __ShortVector_expr< B, T, N >& b ) {
+    return __functor_ShortVector< T, N >::dot( a.self(), b.self() );
+}
 
 /*!***************************************************************************************
  * Cross product \f$ \times : \{a, b\}\in R^3 \times R^3 \rightarrow c\in R^3, \quad c_i = \sum_{j,k}\,  a_j b_k \, \varepsilon^{ijk} \f$
  *****************************************************************************************/
-template< typename T >
-inline const ShortVector< T, 3 > cross( const ShortVector< T, 3 >& A, const ShortVector< T, 3 >& B ) {
+template< class EA, class EB, typename T >
+inline const ShortVector< T, 3 > cross( const __ShortVector_expr< EA, T, 3 >& a, const __ShortVector_expr< EB, T, 3 >& b ) {
+    const ShortVector< T, 3 > A( a ), B( b );
     ShortVector< T, 3 > C;
 
     C.data[0] = A.data[1]*B.data[2];
@@ -367,32 +609,32 @@ inline const ShortVector< T, 3 > cross( const ShortVector< T, 3 >& A, const Shor
 /*!***************************************************************************************
  * Triple product \f$ \left[\cdot,\cdot,\cdot\right] : \{a, b, c\}\in R^3 \times R^3 \times R^3 \rightarrow d\in R, \quad d = a \cdot (b\times c)= (a \times b)\cdot c \f$
  *****************************************************************************************/
-template< typename T >
-inline const T triple( const ShortVector< T, 3 >& A, const ShortVector< T, 3 >& B, const ShortVector< T, 3 >& C ) {
+template< class EA, class EB, class EC, typename T >
+inline const T triple( const __ShortVector_expr< EA, T, 3 >& A, const __ShortVector_expr< EB, T, 3 >& B, const __ShortVector_expr< EC, T, 3 >& C ) {
     return dot( A, cross(B,C) );
 }
 
 /*!***************************************************************************************
  * Norm squared \f$ \left< A,A \right> \f$
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const T norm2( const ShortVector< T, N >& A ) {
+template< class E, typename T, unsigned N >
+inline const T norm2( const __ShortVector_expr< E, T, N >& A ) {
     return dot(A,A);
 }
 
 /*!***************************************************************************************
  * Norm \f$ \sqrt{\left< A,A \right>} \f$
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const T norm( const ShortVector< T, N >& A ) {
+template< class E, typename T, unsigned N >
+inline const T norm( const __ShortVector_expr< E, T, N >& A ) {
     return sqrt(dot(A,A));
 }
 
 /*!***************************************************************************************
  * Normalized vector \f$ A/\sqrt{\left< A,A \right>} \f$
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const ShortVector< T, N > normalized( const ShortVector< T, N >& A ) {
+template< class E, typename T, unsigned N >
+inline const ShortVector< T, N > normalized( const __ShortVector_expr< E, T, N >& A ) {
     ShortVector< T, N > C = A;
     const T aux           = static_cast<T>(1.)/norm(C);
     C                    *= aux;
@@ -411,9 +653,10 @@ inline void normalize( ShortVector< T, N >& A ) {
 /*!***************************************************************************************
  * Angle between vectors \f$ \text{acos}\left(\frac{\left< A,B \right>}{\|A\|\cdot\|B\|}\right) \f$
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline const T angle( const ShortVector< T, N >& A, const ShortVector< T, N >& B ) {
-    return acos( scal(A,B)/sqrt( norm2(A) * norm2(B) ) );
+template< class EA, class EB, typename T, unsigned N >
+inline const T angle( const __ShortVector_expr< EA, T, N >& a, const __ShortVector_expr< EB, T, N >& b ) {
+    const ShortVector< T, N > A( a ), B( b );
+    return acos( dot(A,B)/sqrt( norm2(A) * norm2(B) ) );
 }
 
 /*!***************************************************************************************
@@ -421,14 +664,16 @@ inline const T angle( const ShortVector< T, N >& A, const ShortVector< T, N >& B
  *****************************************************************************************/
 template< typename T, unsigned N >
 inline void zero( ShortVector< T, N >& C ) {
-    memset( C.data, 0, sizeof(T)*N );
+    for ( unsigned k = 0; k < N; k++ )
+        C.data[k] = static_cast<T>(0.);
 }
 
 /*!***************************************************************************************
- * Stream formated.
+ * Stream formated, expressions are evaluated first.
  *****************************************************************************************/
-template< typename T, unsigned N >
-inline std::ostream& operator<< ( std::ostream& out, const ShortVector<T, N>& v ) {
+template< class E, typename T, unsigned N >
+inline std::ostream& operator<< ( std::ostream& out, const __ShortVector_expr< E, T, N >& e ) {
+    const ShortVector< T, N > v( e );
     out << "( ";
     for ( unsigned k = 0; k < N; k++ )
         out << v.data[k] << ((k < N - 1 ) ? ", " : "");
@@ -0,0 +1,195 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+/*! \file */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <math/shortvector.hpp>
+#include <utils/alignedallocator.hpp>
+
+namespace math {
+
+/** @addtogroup ShortVector
+ *
+ *  @{
+ */
+
+/*!***************************************************************************************
+ * @class ShortVectorArray
+ * @brief Array of N dimensional vectors stored as struct of arrays
+ *
+ * Component k of all vectors is contiguous at component(k), every component array starts
+ * on a cache line and has stride() >= size() entries, a multiple of the cache line. The
+ * entries between size() and stride() are zero, so SIMD loops may run over the full
+ * stride without a remainder loop.
+ *****************************************************************************************/
+template< typename T, unsigned N >
+class ShortVectorArray {
+public:
+    static constexpr unsigned alignment = 64;                           //!< bytes, one cache line
+    static constexpr unsigned lanes     = alignment/sizeof(T);          //!< granularity of the stride
+
+    typedef ShortVector< T, N >                                 Vector;
+    typedef std::vector< T, alloc::AlignedAllocator< T, alignment > >  Storage;
+
+protected:
+    unsigned    _size;
+    unsigned    _stride;
+    Storage     _data;
+
+    static const unsigned roundUp( const unsigned n ) { return ( (n + lanes - 1)/lanes )*lanes; }
+
+    //! move the components to a new stride, entries beyond size are zero
+    void restride( const unsigned stride ) {
+        Storage aux( static_cast< std::size_t >( stride )*N, static_cast<T>(0.) );
+        for ( unsigned k = 0; k < N; k++ )
+            std::copy( _data.begin() + k*_stride, _data.begin() + k*_stride + _size, aux.begin() + k*stride );
+        _data.swap( aux );
+        _stride = stride;
+    }
+
+public:
+    /*!***************************************************************************************
+    * Construct n zero vectors.
+    *****************************************************************************************/
+    explicit ShortVectorArray( const unsigned n = 0 ) :
+        _size( n ), _stride( roundUp( n ) ), _data( static_cast< std::size_t >( _stride )*N, static_cast<T>(0.) ) {}
+
+    /*!***************************************************************************************
+    * Construct n copies of v.
+    *****************************************************************************************/
+    ShortVectorArray( const unsigned n, const Vector& v ) : ShortVectorArray( n ) {
+        fill( v );
+    }
+
+    const unsigned size()   const { return _size; }
+    const unsigned stride() const { return _stride; }
+    const bool     empty()  const { return _size == 0; }
+
+    //! contiguous array of the k-th components, aligned to alignment bytes
+    inline T*       component( const unsigned k )       { return _data.data() + k*_stride; }
+    inline const T* component( const unsigned k ) const { return _data.data() + k*_stride; }
+
+    //! k-th component of the p-th vector
+    inline T&       operator () ( const unsigned p, const unsigned k )       { return _data[ k*_stride + p ]; }
+    inline const T& operator () ( const unsigned p, const unsigned k ) const { return _data[ k*_stride + p ]; }
+
+    //! p-th vector
+    inline const Vector get( const unsigned p ) const {
+        Vector v;
+        for ( unsigned k = 0; k < N; k++ )
+            v.data[k] = _data[ k*_stride + p ];
+        return v;
+    }
+
+    inline const Vector operator [] ( const unsigned p ) const { return get( p ); }
+
+    inline void set( const unsigned p, const Vector& v ) {
+        for ( unsigned k = 0; k < N; k++ )
+            _data[ k*_stride + p ] = v.data[k];
+    }
+
+    void fill( const Vector& v ) {
+        for ( unsigned k = 0; k < N; k++ )
+            std::fill( component( k ), component( k ) + _size, v.data[k] );
+    }
+
+    void reserve( const unsigned n ) {
+        if ( n > _stride ) restride( roundUp( n ) );
+    }
+
+    //! new vectors are zero
+    void resize( const unsigned n ) {
+        if ( n > _stride ) {
+            restride( roundUp( std::max( n, 2*_stride ) ) );
+        } else if ( n < _size ) {
+            for ( unsigned k = 0; k < N; k++ )
+                std::fill( component( k ) + n, component( k ) + _size, static_cast<T>(0.) );
+        }
+        _size = n;
+    }
+
+    void clear() { resize( 0 ); }
+
+    void push_back( const Vector& v ) {
+        resize( _size + 1 );
+        set( _size - 1, v );
+    }
+};
+
+template< typename T, unsigned N >
+constexpr unsigned ShortVectorArray< T, N >::alignment;
+
+template< typename T, unsigned N >
+constexpr unsigned ShortVectorArray< T, N >::lanes;
+
+/*!***************************************************************************************
+ * Gather n vectors into the struct of arrays layout, dst is resized to n.
+ *****************************************************************************************/
+template< typename T, unsigned N >
+inline void gather( const ShortVector< T, N >* src, const unsigned n, ShortVectorArray< T, N >& dst ) {
+    dst.resize( n );
+    for ( unsigned k = 0; k < N; k++ ) {
+        T* __restrict__ c = dst.component( k );
+        for ( unsigned p = 0; p < n; p++ )
+            c[p] = src[p].data[k];
+    }
+}
+
+template< typename T, unsigned N >
+inline void gather( const std::vector< ShortVector< T, N > >& src, ShortVectorArray< T, N >& dst ) {
+    gather( src.data(), src.size(), dst );
+}
+
+/*!***************************************************************************************
+ * Scatter all vectors of src to dst, which must hold src.size() vectors.
+ *****************************************************************************************/
+template< typename T, unsigned N >
+inline void scatter( const ShortVectorArray< T, N >& src, ShortVector< T, N >* dst ) {
+    for ( unsigned k = 0; k < N; k++ ) {
+        const T* __restrict__ c = src.component( k );
+        for ( unsigned p = 0; p < src.size(); p++ )
+            dst[p].data[k] = c[p];
+    }
+}
+
+template< typename T, unsigned N >
+inline void scatter( const ShortVectorArray< T, N >& src, std::vector< ShortVector< T, N > >& dst ) {
+    dst.resize( src.size() );
+    scatter( src, dst.data() );
+}
+
+
+/** @} */
+}
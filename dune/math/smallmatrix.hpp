@@ -34,8 +34,11 @@
 
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <error/matherror.hpp>
 #include <math/addressinghelper.hpp>
-#include <utils/fastmemcpy.h>
 
 #define SMALL_MATRIX_INIT_ZERO
 
@@ -46,28 +49,90 @@ namespace math {
  *  @{
  */
 
+//======= expression templates ==========================================================
+// As for ShortVector, element wise sums, differences and scalar multiples are evaluated
+// lazily in one loop on assignment. Matrix products are evaluated immediately.
+
+template< typename T, unsigned M, unsigned N >
+struct SmallMatrix;
+
+template< class E, typename T, unsigned M, unsigned N >
+struct __SmallMatrix_expr {
+    inline const E& self() const { return static_cast< const E& >( *this ); }
+};
+
+template< class E >
+struct __SmallMatrix_operand { typedef const E type; };
+
 template< typename T, unsigned M, unsigned N >
-struct SmallMatrix {
-    T               data [M*N];
-    const unsigned  MxN;
+struct __SmallMatrix_operand< SmallMatrix< T, M, N > > { typedef const SmallMatrix< T, M, N >& type; };
+
+template< class A, class B, typename T, unsigned M, unsigned N >
+struct __SmallMatrix_sum : public __SmallMatrix_expr< __SmallMatrix_sum< A, B, T, M, N >, T, M, N > {
+    typename __SmallMatrix_operand< A >::type a;
+    typename __SmallMatrix_operand< B >::type b;
+
+    __SmallMatrix_sum( const A& a_, const B& b_ ) : a( a_ ), b( b_ ) {}
+
+    inline T at( const unsigned k ) const { return a.at( k ) + b.at( k ); }
+};
+
+template< class A, class B, typename T, unsigned M, unsigned N >
+struct __SmallMatrix_diff : public __SmallMatrix_expr< __SmallMatrix_diff< A, B, T, M, N >, T, M, N > {
+    typename __SmallMatrix_operand< A >::type a;
+    typename __SmallMatrix_operand< B >::type b;
+
+    __SmallMatrix_diff( const A& a_, const B& b_ ) : a( a_ ), b( b_ ) {}
+
+    inline T at( const unsigned k ) const { return a.at( k ) - b.at( k ); }
+};
+
+template< class A, typename T, unsigned M, unsigned N >
+struct __SmallMatrix_scaled : public __SmallMatrix_expr< __SmallMatrix_scaled< A, T, M, N >, T, M, N > {
+    const T                                  s;
+    typename __SmallMatrix_operand< A >::type a;
 
-    SmallMatrix() : MxN(M*N) {
+    __SmallMatrix_scaled( const T s_, const A& a_ ) : s( s_ ), a( a_ ) {}
+
+    inline T at( const unsigned k ) const { return s*a.at( k ); }
+};
+
+template< typename ... _T >
+struct __SmallMatrix_scalars { enum { value = 1 }; };
+
+template< typename _T0, typename ... _T >
+struct __SmallMatrix_scalars< _T0, _T ... > {
+    enum { value = std::is_arithmetic< _T0 >::value && __SmallMatrix_scalars< _T ... >::value };
+};
+
+
+template< typename T, unsigned M, unsigned N >
+struct SmallMatrix : public __SmallMatrix_expr< SmallMatrix< T, M, N >, T, M, N > {
+    static constexpr unsigned MxN = M*N;
+
+    T               data [MxN];
+
+    SmallMatrix() {
         #ifdef SMALL_MATRIX_INIT_ZERO
-        memset( data, 0, sizeof(T)*MxN );
+        for ( unsigned k = 0; k < MxN; k++ )
+            data[k] = static_cast<T>(0.);
         #endif
     }
 
-    SmallMatrix( const SmallMatrix< T, M, N >& rhs ) : MxN(M*N) {
-        fast_memcpy( data, rhs.data, sizeof(T)*MxN );
+    SmallMatrix( const SmallMatrix< T, M, N >& rhs ) = default;
+
+    template< class E >
+    SmallMatrix( const __SmallMatrix_expr< E, T, M, N >& rhs ) {
+        assign( rhs.self() );
     }
 
-    template< typename ... _T >
-    SmallMatrix( const _T ... in ) : MxN(M*N) {
+    template< typename ... _T, typename = typename std::enable_if< __SmallMatrix_scalars< _T ... >::value >::type >
+    SmallMatrix( const _T ... in ) {
         static_assert( (M*N == sizeof...(in)) || ((1 == sizeof...(in)) && (M==N)), "Invalid number of arguments in constructor" );
 
         T val [] = { static_cast<T>( in ) ... };
 
-        if ( N == sizeof...(in) )
+        if ( MxN == sizeof...(in) )
             for ( unsigned k = 0; k < MxN; k++ )
                 data[k] = val[k];
         else
@@ -83,8 +148,13 @@ struct SmallMatrix {
     inline T& operator () ( const unsigned m, const unsigned n ) { return data[rmat_idx<M,N>(m,n)]; }
     inline const T& operator () ( const unsigned m, const unsigned n ) const { return data[rmat_idx<M,N>(m,n)]; }
 
-    inline const SmallMatrix< T, M, N >& operator = ( const SmallMatrix< T, M, N >& rhs ) {
-        fast_memcpy( data, rhs.data, sizeof(T)*MxN );
+    inline T at( const unsigned k ) const { return data[k]; }
+
+    inline SmallMatrix< T, M, N >& operator = ( const SmallMatrix< T, M, N >& rhs ) = default;
+
+    template< class E >
+    inline const SmallMatrix< T, M, N >& operator = ( const __SmallMatrix_expr< E, T, M, N >& rhs ) {
+        assign( rhs.self() );
         return *this;
     }
 
@@ -99,15 +169,15 @@ struct SmallMatrix {
         return *this;
     }
 
-    inline const SmallMatrix< T, M, N >& operator += ( const SmallMatrix< T, M, N >& rhs ) {
-        for ( unsigned k = 0; k < MxN; k++ )
-            data[k] += rhs.data[k];
+    template< class E >
+    inline const SmallMatrix< T, M, N >& operator += ( const __SmallMatrix_expr< E, T, M, N >& rhs ) {
+        assign( __SmallMatrix_sum< SmallMatrix< T, M, N >, E, T, M, N >( *this, rhs.self() ) );
         return *this;
     }
 
-    inline const SmallMatrix< T, M, N >& operator -= ( const SmallMatrix< T, M, N >& rhs ) {
-        for ( unsigned k = 0; k < MxN; k++ )
-            data[k] += rhs.data[k];
+    template< class E >
+    inline const SmallMatrix< T, M, N >& operator -= ( const __SmallMatrix_expr< E, T, M, N >& rhs ) {
+        assign( __SmallMatrix_diff< SmallMatrix< T, M, N >, E, T, M, N >( *this, rhs.self() ) );
         return *this;
     }
 
@@ -123,30 +193,31 @@ struct SmallMatrix {
             data[k] *= aux;
         return *this;
     }
+
+private:
+    template< class E >
+    inline void assign( const E& e ) {
+        for ( unsigned k = 0; k < MxN; k++ )
+            data[k] = e.at( k );
+    }
 };
 
 template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator + ( const SmallMatrix< T, M, N >& A, const SmallMatrix< T, M, N >& B ) {
-    SmallMatrix< T, M, N > C;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = A.data[k] + B.data[k];
-    return C;
+constexpr unsigned SmallMatrix< T, M, N >::MxN;
+
+template< class A, class B, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_sum< A, B, T, M, N > operator + ( const __SmallMatrix_expr< A, T, M, N >& a, const __SmallMatrix_expr< B, T, M, N >& b ) {
+    return __SmallMatrix_sum< A, B, T, M, N >( a.self(), b.self() );
 }
 
-template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator - ( const SmallMatrix< T, M, N >& A, const SmallMatrix< T, M, N >& B ) {
-    SmallMatrix< T, M, N > C;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = A.data[k] - B.data[k];
-    return C;
+template< class A, class B, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_diff< A, B, T, M, N > operator - ( const __SmallMatrix_expr< A, T, M, N >& a, const __SmallMatrix_expr< B, T, M, N >& b ) {
+    return __SmallMatrix_diff< A, B, T, M, N >( a.self(), b.self() );
 }
 
-template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator - ( const SmallMatrix< T, M, N >& A ) {
-    SmallMatrix< T, M, N > C;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = -A.data[k];
-    return C;
+template< class A, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_scaled< A, T, M, N > operator - ( const __SmallMatrix_expr< A, T, M, N >& a ) {
+    return __SmallMatrix_scaled< A, T, M, N >( static_cast<T>(-1.), a.self() );
 }
 
 template< typename T, unsigned L, unsigned M, unsigned N >
@@ -161,29 +232,19 @@ inline const SmallMatrix< T, L, N > operator * ( const SmallMatrix< T, L, M >& A
     return C;
 }
 
-template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator * ( const T A, const SmallMatrix< T, M, N >& B ) {
-    SmallMatrix< T, M, N > C;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = A*B.data[k];
-    return C;
+template< class B, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_scaled< B, T, M, N > operator * ( const T A, const __SmallMatrix_expr< B, T, M, N >& b ) {
+    return __SmallMatrix_scaled< B, T, M, N >( A, b.self() );
 }
 
-template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator * ( const SmallMatrix< T, M, N >& A, const T B ) {
-    SmallMatrix< T, M, N > C;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = A.data[k]*B;
-    return C;
+template< class A, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_scaled< A, T, M, N > operator * ( const __SmallMatrix_expr< A, T, M, N >& a, const T B ) {
+    return __SmallMatrix_scaled< A, T, M, N >( B, a.self() );
 }
 
-template< typename T, unsigned M, unsigned N >
-inline const SmallMatrix< T, M, N > operator / ( const SmallMatrix< T, M, N >& A, const T B ) {
-    SmallMatrix< T, M, N > C;
-    const T aux = 1./B;
-    for ( unsigned k = 0; k < C.MxN; k++ )
-        C.data[k] = A.data[k]*aux;
-    return C;
+template< class A, typename T, unsigned M, unsigned N >
+inline const __SmallMatrix_scaled< A, T, M, N > operator / ( const __SmallMatrix_expr< A, T, M, N >& a, const T B ) {
+    return __SmallMatrix_scaled< A, T, M, N >( static_cast<T>(1.)/B, a.self() );
 }
 
 //======= determinant ===================================================================
@@ -369,5 +430,230 @@ inline void zero( SmallMatrix< T, M, N >& C ) {
 }
 
 
+//======= factorizations and inverse ====================================================
+// All loops run over compile time bounds and are unrolled by the compiler for the small
+// sizes used here, N = 1..3 invert in closed form. A matrix counts as singular if a pivot
+// or the determinant does not exceed N*eps relative to the magnitude of its entries.
+
+template< typename T, unsigned M, unsigned N >
+inline const T maxabs( const SmallMatrix< T, M, N >& A ) {
+    T C = std::abs( A.data[0] );
+    for ( unsigned k = 1; k < A.MxN; k++ )
+        C = std::max( C, std::abs( A.data[k] ) );
+    return C;
+}
+
+template< typename T, unsigned N >
+inline const bool __SmallMatrix_negligible( const T x, const T scale ) {
+    return !( std::abs( x ) > N*std::numeric_limits<T>::epsilon()*scale );
+}
+
+/*!
+ * LU factorization with partial pivoting, P A = L U. lu holds L below the diagonal
+ * (unit diagonal implied) and U on and above it, row k of P A is row piv[k] of A.
+ */
+template< typename T, unsigned N >
+struct SmallLU {
+    SmallMatrix< T, N, N >  lu;
+    unsigned                piv[N];
+    bool                    regular;
+};
+
+template< typename T, unsigned N >
+inline const bool lu( const SmallMatrix< T, N, N >& A, SmallLU< T, N >& F ) {
+    const T scale = maxabs( A );
+    F.lu      = A;
+    F.regular = true;
+    for ( unsigned k = 0; k < N; k++ )
+        F.piv[k] = k;
+
+    for ( unsigned k = 0; k < N; k++ ) {
+        unsigned p = k;
+        for ( unsigned i = k+1; i < N; i++ )
+            if ( std::abs( F.lu(i,k) ) > std::abs( F.lu(p,k) ) ) p = i;
+
+        if ( p != k ) {
+            for ( unsigned j = 0; j < N; j++ )
+                std::swap( F.lu(k,j), F.lu(p,j) );
+            std::swap( F.piv[k], F.piv[p] );
+        }
+
+        if ( __SmallMatrix_negligible< T, N >( F.lu(k,k), scale ) ) {
+            F.regular = false;
+            return false;
+        }
+
+        const T aux = static_cast<T>(1.)/F.lu(k,k);
+        for ( unsigned i = k+1; i < N; i++ ) {
+            F.lu(i,k) *= aux;
+            for ( unsigned j = k+1; j < N; j++ )
+                F.lu(i,j) -= F.lu(i,k)*F.lu(k,j);
+        }
+    }
+    return true;
+}
+
+//! solve A X = B for K right hand sides with a regular factorization of A
+template< typename T, unsigned N, unsigned K >
+inline const SmallMatrix< T, N, K > solve( const SmallLU< T, N >& F, const SmallMatrix< T, N, K >& B ) {
+    SmallMatrix< T, N, K > X;
+    for ( unsigned c = 0; c < K; c++ ) {
+        for ( unsigned i = 0; i < N; i++ ) {
+            T s = B(F.piv[i],c);
+            for ( unsigned j = 0; j < i; j++ )
+                s -= F.lu(i,j)*X(j,c);
+            X(i,c) = s;
+        }
+        for ( unsigned i = N; i-- > 0; ) {
+            T s = X(i,c);
+            for ( unsigned j = i+1; j < N; j++ )
+                s -= F.lu(i,j)*X(j,c);
+            X(i,c) = s/F.lu(i,i);
+        }
+    }
+    return X;
+}
+
+/*!
+ * Cholesky factorization A = L L^T of a symmetric positive definite matrix, only the
+ * lower triangle of A is read.
+ */
+template< typename T, unsigned N >
+struct SmallCholesky {
+    SmallMatrix< T, N, N >  L;
+    bool                    regular;
+};
+
+template< typename T, unsigned N >
+inline const bool cholesky( const SmallMatrix< T, N, N >& A, SmallCholesky< T, N >& F ) {
+    const T scale = maxabs( A );
+    zero( F.L );
+    F.regular = true;
+
+    for ( unsigned j = 0; j < N; j++ ) {
+        T d = A(j,j);
+        for ( unsigned k = 0; k < j; k++ )
+            d -= F.L(j,k)*F.L(j,k);
+        if ( __SmallMatrix_negligible< T, N >( d, scale ) || (d < 0) ) {
+            F.regular = false;
+            return false;
+        }
+        F.L(j,j) = std::sqrt( d );
+
+        const T aux = static_cast<T>(1.)/F.L(j,j);
+        for ( unsigned i = j+1; i < N; i++ ) {
+            T s = A(i,j);
+            for ( unsigned k = 0; k < j; k++ )
+                s -= F.L(i,k)*F.L(j,k);
+            F.L(i,j) = s*aux;
+        }
+    }
+    return true;
+}
+
+template< typename T, unsigned N, unsigned K >
+inline const SmallMatrix< T, N, K > solve( const SmallCholesky< T, N >& F, const SmallMatrix< T, N, K >& B ) {
+    SmallMatrix< T, N, K > X;
+    for ( unsigned c = 0; c < K; c++ ) {
+        for ( unsigned i = 0; i < N; i++ ) {
+            T s = B(i,c);
+            for ( unsigned j = 0; j < i; j++ )
+                s -= F.L(i,j)*X(j,c);
+            X(i,c) = s/F.L(i,i);
+        }
+        for ( unsigned i = N; i-- > 0; ) {
+            T s = X(i,c);
+            for ( unsigned j = i+1; j < N; j++ )
+                s -= F.L(j,i)*X(j,c);
+            X(i,c) = s/F.L(i,i);
+        }
+    }
+    return X;
+}
+
+//======= inverse =======================================================================
+
+template< typename T, unsigned N >
+struct __functor_SmallMatrix_inv {
+    inline const bool operator()( const SmallMatrix< T, N, N >& A, SmallMatrix< T, N, N >& C ) const {
+        SmallLU< T, N > F;
+        if ( !lu( A, F ) ) return false;
+        C = solve( F, SmallMatrix< T, N, N >( static_cast<T>(1.) ) );
+        return true;
+    }
+};
+
+template< typename T > struct __functor_SmallMatrix_inv<T,1> {
+    inline const bool operator()( const SmallMatrix< T, 1, 1 >& A, SmallMatrix< T, 1, 1 >& C ) const {
+        if ( __SmallMatrix_negligible< T, 1 >( A.data[0], std::abs( A.data[0] ) ) ) return false;
+        C.data[0] = static_cast<T>(1.)/A.data[0];
+        return true;
+    }
+};
+
+template< typename T > struct __functor_SmallMatrix_inv<T,2> {
+    inline const bool operator()( const SmallMatrix< T, 2, 2 >& A, SmallMatrix< T, 2, 2 >& C ) const {
+        const T D     = det( A );
+        const T scale = maxabs( A );
+        if ( __SmallMatrix_negligible< T, 2 >( D, scale*scale ) ) return false;
+
+        const T aux = static_cast<T>(1.)/D;
+        C(0,0) =  aux*A(1,1);   C(0,1) = -aux*A(0,1);
+        C(1,0) = -aux*A(1,0);   C(1,1) =  aux*A(0,0);
+        return true;
+    }
+};
+
+template< typename T > struct __functor_SmallMatrix_inv<T,3> {
+    inline const bool operator()( const SmallMatrix< T, 3, 3 >& A, SmallMatrix< T, 3, 3 >& C ) const {
+        // adjugate, the first column of cofactors gives the determinant
+        const T c00 = A(1,1)*A(2,2) - A(1,2)*A(2,1);
+        const T c10 = A(1,2)*A(2,0) - A(1,0)*A(2,2);
+        const T c20 = A(1,0)*A(2,1) - A(1,1)*A(2,0);
+        const T D     = A(0,0)*c00 + A(0,1)*c10 + A(0,2)*c20;
+        const T scale = maxabs( A );
+        if ( __SmallMatrix_negligible< T, 3 >( D, scale*scale*scale ) ) return false;
+
+        const T aux = static_cast<T>(1.)/D;
+        C(0,0) = aux*c00;
+        C(1,0) = aux*c10;
+        C(2,0) = aux*c20;
+        C(0,1) = aux*( A(0,2)*A(2,1) - A(0,1)*A(2,2) );
+        C(1,1) = aux*( A(0,0)*A(2,2) - A(0,2)*A(2,0) );
+        C(2,1) = aux*( A(0,1)*A(2,0) - A(0,0)*A(2,1) );
+        C(0,2) = aux*( A(0,1)*A(1,2) - A(0,2)*A(1,1) );
+        C(1,2) = aux*( A(0,2)*A(1,0) - A(0,0)*A(1,2) );
+        C(2,2) = aux*( A(0,0)*A(1,1) - A(0,1)*A(1,0) );
+        return true;
+    }
+};
+
+//! C = A^-1, returns false and leaves C undefined if A is singular
+template< typename T, unsigned N >
+inline const bool invert( const SmallMatrix< T, N, N >& A, SmallMatrix< T, N, N >& C ) {
+    __functor_SmallMatrix_inv< T, N > func_inv;
+    return func_inv( A, C );
+}
+
+//! A^-1, throws SingularMatrixError if A is singular
+template< typename T, unsigned N >
+inline const SmallMatrix< T, N, N > inverse( const SmallMatrix< T, N, N >& A ) {
+    SmallMatrix< T, N, N > C;
+    if ( !invert( A, C ) ) throw SingularMatrixError( __ERROR_INFO__ );
+    return C;
+}
+
+//! invert n matrices, regular[k] (if given) tells whether A[k] was invertible, returns the number of singular ones
+template< typename T, unsigned N >
+inline const unsigned invert( const SmallMatrix< T, N, N >* A, SmallMatrix< T, N, N >* C, const unsigned n, bool* regular = NULL ) {
+    unsigned singular = 0;
+    for ( unsigned k = 0; k < n; k++ ) {
+        const bool ok = invert( A[k], C[k] );
+        if ( regular ) regular[k] = ok;
+        if ( !ok ) singular++;
+    }
+    return singular;
+}
+
 /** @} */
 }
@@ -0,0 +1,131 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+/*! \file */
+#pragma once
+
+#include <ostream>
+#include <type_traits>
+#include <utils/tuple.hpp>
+#include <math/addressinghelper.hpp>
+
+#define STATIC_TENSOR_INIT_ZERO
+
+namespace math {
+
+/** @addtogroup StaticTensor
+ *
+ *  @{
+ */
+
+/**
+ * Dense row-major tensor with extents N... fixed at compile time. The data lives inline,
+ * so a StaticTensor can be placed on the stack or inside other objects, e.g. as storage
+ * for tabulated basis function values, without touching the heap. All offsets are
+ * resolved through the compile time strides of addressinghelper.hpp.
+ */
+template< typename T, int ... N >
+struct StaticTensor {
+    static_assert( sizeof...(N) > 0, "StaticTensor needs at least one extent." );
+
+    static constexpr unsigned rank = sizeof...(N);
+    static constexpr unsigned size = ten_size< N... >::value;
+
+    alignas(16) T   data [size];
+
+    StaticTensor() {
+        #ifdef STATIC_TENSOR_INIT_ZERO
+        for ( unsigned k = 0; k < size; k++ )
+            data[k] = static_cast<T>(0.);
+        #endif
+    }
+
+    StaticTensor( const StaticTensor< T, N... >& rhs ) = default;
+
+    inline StaticTensor< T, N... >& operator = ( const StaticTensor< T, N... >& rhs ) = default;
+
+    //! extent of index K
+    template< unsigned K >
+    static constexpr int extent() { return ten_extent< K, N... >::value; }
+
+    //! distance in data between consecutive values of index K
+    template< unsigned K >
+    static constexpr int stride() { return rten_stride< K, N... >::value; }
+
+    template< typename ... I >
+    inline T& operator () ( const I ... i ) {
+        static_assert( sizeof...(I) == rank, "Invalid number of indices." );
+        return data[rten_idx< N... >( i... )];
+    }
+
+    template< typename ... I >
+    inline const T& operator () ( const I ... i ) const {
+        static_assert( sizeof...(I) == rank, "Invalid number of indices." );
+        return data[rten_idx< N... >( i... )];
+    }
+
+    inline T& operator () ( const TupleA< int, sizeof...(N) >& idx ) { return data[rten_idx< N... >( idx )]; }
+    inline const T& operator () ( const TupleA< int, sizeof...(N) >& idx ) const { return data[rten_idx< N... >( idx )]; }
+
+    //! first entry of the sub-tensor selected by the leading indices i...
+    template< typename ... I >
+    inline T* at( const I ... i ) {
+        static_assert( sizeof...(I) <= rank, "Invalid number of indices." );
+        return data + __rten_offset< N... >::eval( static_cast<int>(i)... );
+    }
+
+    template< typename ... I >
+    inline const T* at( const I ... i ) const {
+        static_assert( sizeof...(I) <= rank, "Invalid number of indices." );
+        return data + __rten_offset< N... >::eval( static_cast<int>(i)... );
+    }
+
+    inline void fill( const T& val ) {
+        for ( unsigned k = 0; k < size; k++ )
+            data[k] = val;
+    }
+};
+
+template< typename T, int ... N > constexpr unsigned StaticTensor< T, N... >::rank;
+template< typename T, int ... N > constexpr unsigned StaticTensor< T, N... >::size;
+
+template< typename T, int ... N >
+inline std::ostream& operator<< ( std::ostream& out, const StaticTensor< T, N... >& t ) {
+    out << "[";
+    for ( unsigned k = 0; k < t.size; k++ )
+        out << " " << t.data[k];
+    out << " ]";
+    return out;
+}
+
+/** @} */
+
+} // namespace math
@@ -32,7 +32,13 @@
 
 #include "test.h"
 #include <omp.h>
-#include <gperftools/profiler.h>
+#include <iomanip>
+#include <stdexcept>
+
+#include <io/trajectorywriter.hpp>
+#include <utils/timing.hpp>
+#include <utils/profiler.hpp>
+#include <utils/alloccounter.hpp>
 
 
 
@@ -136,55 +142,52 @@ public:
 
 protected:
     typedef typename Dune::PDELab::LocalFunctionSpace<typename SetupTraits::GridFunctionSpace > LFSU;
-    LFSU lfsu;
-
-public:
-    FemLocalEvalOperator ( const typename SetupTraits::GridFunctionSpace& gfs_ ) : lfsu(gfs_) {}
-
-    // pointwise eval
-    template< typename IT, typename X, class FieldU >
-    const Result eval ( IT& it, const X& x, const FieldU& field )
+    typedef typename LFSU::Traits::FiniteElementType                                            FiniteElement;
+    typedef typename Dune::PDELab::LocalVector<typename SetupTraits::FieldU::ElementType,
+                                               Dune::PDELab::TrialSpaceTag>                     LocalVector;
+    LFSU                                lfsu;
+    LocalVector                         ul;     // local coefficients of the last vread, reused
+    const typename SetupTraits::FEM&    fem;
+
+    // evaluate u and grad u from the local coefficients ul with the inverse transposed Jacobian jac at x
+    template< typename JIT, typename X, typename UL >
+    const Result evalLocal ( const JIT& jac, const FiniteElement& fe, const X& x, const UL& ul ) const
     {
         // extract some types
         typedef typename SetupTraits::Real Real;
-        typedef typename LFSU::Traits::FiniteElementType::Traits::LocalBasisType::Traits::DomainFieldType   DF;
-        typedef typename LFSU::Traits::FiniteElementType::Traits::LocalBasisType::Traits::RangeFieldType    RF;
-        typedef typename LFSU::Traits::FiniteElementType::Traits::LocalBasisType::Traits::JacobianType      JacobianType;
-        typedef typename LFSU::Traits::FiniteElementType::Traits::LocalBasisType::Traits::RangeType         RangeType;
-        typedef typename LFSU::Traits::SizeType                                                             size_type;
-
+        typedef typename FiniteElement::Traits::LocalBasisType::Traits::RangeFieldType    RF;
+        typedef typename FiniteElement::Traits::LocalBasisType::Traits::JacobianType      JacobianType;
+        typedef typename FiniteElement::Traits::LocalBasisType::Traits::RangeType         RangeType;
 
         // dimensions
         const int dim   = SetupTraits::dim;
         const int dimw  = SetupTraits::dimw;
 
-        Dune::PDELab::LocalVector<typename SetupTraits::FieldU::ElementType, Dune::PDELab::TrialSpaceTag> ul;
-        ul.resize(lfsu.size());
+        const unsigned n = fe.localBasis().size();
 
-        const typename SetupTraits::GridType::template Codim<0>::Entity& e = *it;
-        lfsu.bind(e);
-        lfsu.vread(field,ul);
+        // scratch space of the calling thread, allocates only on its first use
+        static thread_local std::vector<RangeType>      phi;
+        static thread_local std::vector<JacobianType>   js;
+        phi.resize(n);
+        js.resize(n);
+
+        //evaluate basis functions on reference element
+        fe.localBasis().evaluateFunction(x,phi);
 
         //compute u at integration point
         Real u = 0.0;
-        std::vector<RangeType> phi(lfsu.size());
-        for ( size_type i = 0; i < lfsu.size(); i++ )
-            u += x[i]*phi[i];
+        for ( unsigned i = 0; i < n; i++ )
+            u += ul[i]*phi[i];
 
         //evaluate gradient of basis functions on reference element
-        std::vector<JacobianType> js(lfsu.size());
-        lfsu.finiteElement().localBasis().evaluateJacobian(x,js);
+        fe.localBasis().evaluateJacobian(x,js);
 
-        //transform gradients from reference element to real element
-        const Dune::FieldMatrix<DF,dimw,dim>    jac = it->geometry().jacobianInverseTransposed(x);
-        std::vector<Dune::FieldVector<RF,dim> > gradphi(lfsu.size());
-        for (size_type i=0; i<lfsu.size(); i++)
-            jac.mv(js[i][0],gradphi[i]);
-
-        //compute gradient of u
-        Dune::FieldVector<RF,dim> gradu(0.0);
-        for (size_type i=0; i<lfsu.size(); i++)
-            gradu.axpy(ul[i],gradphi[i]);
+        //transform gradients from reference element to real element and compute gradient of u
+        Dune::FieldVector<RF,dim> gradu(0.0), gradphi;
+        for (unsigned i=0; i<n; i++) {
+            jac.mv(js[i][0],gradphi);
+            gradu.axpy(ul[i],gradphi);
+        }
 
         Result res;
         res.u = u;
@@ -196,6 +199,242 @@ public:
         return res;
     }
 
+public:
+    FemLocalEvalOperator ( const typename SetupTraits::GridFunctionSpace& gfs_ ) : lfsu(gfs_), fem(gfs_.finiteElementMap()) {}
+
+    // pointwise eval, gathers the local coefficients through the DOF mapping
+    template< typename IT, typename X, class FieldU >
+    const Result eval ( IT& it, const X& x, const FieldU& field )
+    {
+        const typename SetupTraits::GridType::template Codim<0>::Entity& e = *it;
+        lfsu.bind(e);
+        ul.resize(lfsu.size());
+        lfsu.vread(field,ul);
+
+        return evalLocal( e.geometry().jacobianInverseTransposed(x), lfsu.finiteElement(), x, ul );
+    }
+
+    // pointwise eval on coefficients taken from a FemCoefficientCache
+    template< typename IT, typename X >
+    const Result eval ( IT& it, const X& x, const typename SetupTraits::Real* ul ) const
+    {
+        const typename SetupTraits::GridType::template Codim<0>::Entity& e = *it;
+        return evalLocal( e.geometry().jacobianInverseTransposed(x), fem.find(e), x, ul );
+    }
+
+    // pointwise eval on cached coefficients in an affine cell given by the inverse jinv of its Jacobian, reads no grid
+    template< typename X, typename JInv >
+    const Result eval ( const FiniteElement& fe, const X& x, const typename SetupTraits::Real* ul, const JInv& jinv ) const
+    {
+        Dune::FieldMatrix< typename SetupTraits::Coord, SetupTraits::dimw, SetupTraits::dim > jac;
+        for ( unsigned i = 0; i < SetupTraits::dimw; i++ )
+            for ( unsigned k = 0; k < SetupTraits::dim; k++ )
+                jac[i][k] = jinv(k,i);
+        return evalLocal( jac, fe, x, ul );
+    }
+
+    template< typename E >
+    const FiniteElement& finiteElement ( const E& e ) const { return fem.find(e); }
+
+};
+
+
+
+/*
+ * Contiguous copy of the local coefficients of a discrete function, one block of
+ * maxLocalSize values per cell, addressed by the cell's leaf index. Replaces the
+ * indirect gather lfsu.vread() by a plain load as long as the function does not change.
+ * Validity is keyed on the function only, so the cache has to be invalidated whenever
+ * the grid, the function space or the values of the function are modified.
+ */
+template< typename SetupTraits >
+class FemCoefficientCache {
+public:
+    typedef typename SetupTraits::Real                  Real;
+    typedef typename SetupTraits::GridFunctionSpace     GridFunctionSpace;
+    typedef typename SetupTraits::FieldU                FieldU;
+
+protected:
+    typedef typename Dune::PDELab::LocalFunctionSpace< GridFunctionSpace > LFSU;
+
+    const GridFunctionSpace&    gfs;
+    LFSU                        lfsu;
+    std::vector< Real >         coeffs;             //!> local coefficients, cell major
+    unsigned                    stride;             //!> number of coefficients stored per cell
+    const FieldU*               source;             //!> the function the cache was built from, NULL if invalid
+
+public:
+    FemCoefficientCache( const GridFunctionSpace& gfs_ ) : gfs(gfs_), lfsu(gfs_), stride(0), source(NULL) {}
+
+    void update( const FieldU& field ) {
+        const auto& gv      = gfs.gridView();
+        const auto& is      = gv.indexSet();
+
+        stride = gfs.maxLocalSize();
+        coeffs.assign( stride*is.size(0), 0. );
+        coeffs.shrink_to_fit();
+
+        Dune::PDELab::LocalVector<typename FieldU::ElementType, Dune::PDELab::TrialSpaceTag> ul;
+        for ( auto it = gv.template begin<0>(); it != gv.template end<0>(); ++it ) {
+            lfsu.bind( *it );
+            ul.resize( lfsu.size() );
+            lfsu.vread( field, ul );
+
+            Real* c = &coeffs[ stride*is.index(*it) ];
+            for ( unsigned i = 0; i < lfsu.size(); i++ )
+                c[i] = ul[i];
+        }
+
+        source = &field;
+    }
+
+    void invalidate() {
+        coeffs.clear();
+        coeffs.shrink_to_fit();
+        source = NULL;
+    }
+
+    const bool        isValid( const FieldU& field ) const { return source == &field; }
+    const Real*       operator[] ( const unsigned index ) const { return &coeffs[stride*index]; }
+    const std::size_t memory() const { return coeffs.capacity()*sizeof(Real); }
+};
+
+
+
+/*
+ * Per-cell affine representation u(x) = a + <g,x> of a discrete function whose gradient
+ * is constant on each cell (P1 on simplices). Built from a valid FemCoefficientCache,
+ * afterwards pointwise evaluation is a locate plus a load. The grid is only read by the
+ * calling thread, entity pointers of ALUGrid come from a per-grid pool, only the
+ * arithmetic on the gathered geometries runs in parallel.
+ */
+template< typename SetupTraits >
+class FemGradientCache {
+public:
+    typedef typename SetupTraits::Real                              Real;
+    typedef typename SetupTraits::GridFunctionSpace                 GridFunctionSpace;
+    typedef typename SetupTraits::FieldU                            FieldU;
+    typedef typename FemLocalEvalOperator< SetupTraits >::Result    Result;
+
+    static constexpr unsigned dim     = SetupTraits::dim;
+    static constexpr unsigned dimw    = SetupTraits::dimw;
+    static constexpr unsigned stride  = SetupTraits::dimw + 1;     //!> gradient and offset per cell
+    static constexpr int      chunk   = 4096;                      //!> cells gathered per serial pass
+
+protected:
+    const GridFunctionSpace&    gfs;
+    std::vector< Real >         data;               //!> g(0) ... g(dimw-1), a for each cell
+    const FieldU*               source;             //!> the function the cache was built from, NULL if invalid
+
+public:
+    FemGradientCache( const GridFunctionSpace& gfs_ ) : gfs(gfs_), source(NULL) {}
+
+    void update( const FemCoefficientCache< SetupTraits >& coeffs, const FieldU& field ) {
+        static_assert( SetupTraits::constantGradient, "The gradient is not constant per cell for this discretization!" );
+
+        typedef typename SetupTraits::GridType::template Codim<0>::EntitySeed      EntitySeed;
+        typedef typename SetupTraits::GridType::template Codim<0>::EntityPointer   EntityPointer;
+        typedef typename SetupTraits::GridType::template Codim<0>::Entity          Entity;
+        typedef typename SetupTraits::FEM::Traits::FiniteElementType               FiniteElement;
+        typedef typename FiniteElement::Traits::LocalBasisType::Traits             BasisTraits;
+
+        if ( !coeffs.isValid( field ) ) throw GridError( "Coefficient cache is not up to date!", __ERROR_INFO__ );
+
+        const auto& gv      = gfs.gridView();
+        const auto& is      = gv.indexSet();
+        const auto& grid    = gv.grid();
+        const auto& fem     = gfs.finiteElementMap();
+        const int   size    = is.size(0);
+
+        // cells in index order, so the passes can address them directly
+        std::vector< EntitySeed > seeds( size );
+        for ( auto it = gv.template begin<0>(); it != gv.template end<0>(); ++it )
+            seeds[ is.index(*it) ] = it->seed();
+
+        data.assign( stride*size, 0. );
+        data.shrink_to_fit();
+
+        std::vector< const FiniteElement* >                 fes ( chunk );
+        std::vector< Dune::FieldVector<Real,dim> >          xls ( chunk );
+        std::vector< Dune::FieldVector<Real,dimw> >         xgs ( chunk );
+        std::vector< Dune::FieldMatrix<Real,dimw,dim> >     jacs( chunk );
+
+        for ( int c0 = 0; c0 < size; c0 += chunk ) {
+            const int nc = ( size - c0 < chunk ) ? size - c0 : chunk;
+
+            // finite element and geometry at the center of each cell of the chunk
+            for ( int i = 0; i < nc; i++ ) {
+                const EntityPointer ep( grid.entityPointer( seeds[c0+i] ) );
+                const Entity&   e   = *ep;
+                const auto&     geo = e.geometry();
+                const auto&     gre = Dune::GenericReferenceElements< Real, dim >::general( geo.type() );
+                fes[i]  = &fem.find( e );
+                xls[i]  = gre.position( 0, 0 );
+                xgs[i]  = geo.global( xls[i] );
+                jacs[i] = geo.jacobianInverseTransposed( xls[i] );
+            }
+
+            #pragma omp parallel
+            {
+                std::vector< typename BasisTraits::RangeType >      phi;
+                std::vector< typename BasisTraits::JacobianType >   js;
+
+                #pragma omp for
+                for ( int i = 0; i < nc; i++ ) {
+                    const FiniteElement& fe = *fes[i];
+                    const Real*     ul  = coeffs[c0+i];
+                    const unsigned  n   = fe.localBasis().size();
+
+                    phi.resize( n );
+                    js.resize( n );
+                    fe.localBasis().evaluateFunction( xls[i], phi );
+                    fe.localBasis().evaluateJacobian( xls[i], js );
+
+                    Dune::FieldVector<Real,dimw> gradu(0.), gradphi;
+                    Real u = 0.;
+                    for ( unsigned j = 0; j < n; j++ ) {
+                        jacs[i].mv( js[j][0], gradphi );
+                        gradu.axpy( ul[j], gradphi );
+                        u += ul[j]*phi[j];
+                    }
+
+                    Real* g = &data[ stride*(c0+i) ];
+                    g[dimw] = u;
+                    for ( unsigned k = 0; k < dimw; k++ ) {
+                        g[k]     = gradu[k];
+                        g[dimw] -= gradu[k]*xgs[i][k];
+                    }
+                }
+            }
+        }
+
+        source = &field;
+    }
+
+    void invalidate() {
+        data.clear();
+        data.shrink_to_fit();
+        source = NULL;
+    }
+
+    //! evaluate at global position xg with local position xl inside the cell with the given index
+    template< typename X, typename XL >
+    const Result eval( const X& xg, const XL& xl, const unsigned index ) const {
+        const Real* g = &data[ stride*index ];
+
+        Result res;
+        res.u = g[dimw];
+        for ( unsigned k = 0; k < dimw; k++ ) {
+            res.x(k)     = xl[k];
+            res.du(k)    = g[k];
+            res.u       += g[k]*xg(k);
+        }
+
+        return res;
+    }
+
+    const bool        isValid( const FieldU& field ) const { return source == &field; }
+    const std::size_t memory() const { return data.capacity()*sizeof(Real); }
 };
 
 
@@ -307,116 +546,85 @@ inline void asShortVector( Dune::FieldVector< T, dim >& f, math::ShortVector< T,
 // }
 
 template< typename BT, unsigned dim >
-struct XT {
-    math::ShortVector< BT, dim > x;
-    BT                           t;
-
-    XT() : x(0.), t(0.) {}
-    XT( const math::ShortVector< BT, dim >& x_, const BT t_ ) : x(x_), t(t_) {}
-    XT( const XT& xt ) : x(xt.x), t(xt.t) {}
+struct IntegrationResult {
+    math::ShortVector< BT, dim > x;             //!> final position
+    BT                           t;             //!> final time
+    unsigned                     steps;         //!> accepted steps
+    unsigned                     rejected;      //!> rejected steps
+    unsigned                     evals;         //!> evaluations of grad u, i.e. point locations
+    double                       time;          //!> wall time
+    bool                         exited;        //!> left the domain before the final time
+
+    IntegrationResult() : x(0.), t(0.), steps(0), rejected(0), evals(0), time(0.), exited(false) {}
 };
 
+/*
+ * Struct-of-arrays state of a particle ensemble for the velocity-Verlet scheme of
+ * FemTest::integrate. Every component lives in its own contiguous, cache line aligned
+ * array, so the update kernels are plain streaming loops. Particles that leave the
+ * domain are masked out (alive = 0) and keep their last state.
+ */
 template< typename BT, unsigned dim >
-class Trajectory {
-private:
-
-protected:
-    bool                         adepting;
-    std::vector< XT<BT, dim> >   data;
-    std::deque< XT<BT, dim> >    dq;
-
-public:
-    Trajectory() : adepting(false) {}
-
-    typename std::vector< XT<BT, dim> >::iterator vector_begin() { if (adepting) throw; return data.begin(); }
-    typename std::vector< XT<BT, dim> >::iterator vector_end()   { if (adepting) throw; return data.end(); }
-
-    typename std::deque< XT<BT, dim> >::iterator deque_begin() { if (!adepting) throw; return dq.begin(); }
-    typename std::deque< XT<BT, dim> >::iterator deque_end()   { if (!adepting) throw; return dq.end(); }
-
-    void preAdept() {
-        dq.clear();
-        dq.reserve( data.size() );
-        std::copy( data.begin(), data.end(), dq );
-        adepting = true;
-    }
-
-    void insert( const XT<BT, dim>& xt ) {
-        if (!adepting) throw;
-    }
-
-    void insert( const XT<BT, dim>& xt, const typename std::deque< XT<BT, dim> >::iterator& it ) {
-        if (!adepting) throw;
-        dq.insert(it, xt);
-    }
-
-    void postAdept() {
-        data.clear();
-        data.reserve( dq.size() );
-        std::copy( dq.begin(), dq.end(), data );
-        dq.clear();
-        adepting = false;
+struct ParticleEnsemble {
+    typedef math::ShortVectorArray< BT, dim >   Array;
+
+    Array               xn;             //!> position
+    Array               xo;             //!> predicted position
+    Array               vn;             //!> velocity
+    Array               vo;             //!> predicted velocity
+    Array               g0;             //!> grad u at the predicted position of the previous step
+    Array               g1;             //!> grad u at the predicted position
+    std::vector< BT >   alive;          //!> 1 while inside the domain, 0 afterwards
+    std::vector< BT >   tExit;          //!> time the particle left the domain
+
+    ParticleEnsemble( const unsigned n ) : xn( n ), xo( n ), vn( n ), vo( n ), g0( n ), g1( n ), alive( n, 1. ), tExit( n, -1. ) {}
+
+    const unsigned size() const { return alive.size(); }
+
+    const unsigned numAlive() const {
+        unsigned n = 0;
+        for ( auto a : alive )
+            n += ( a != 0. );
+        return n;
     }
 
-    void push_back( const XT<BT, dim>& xt ) {
-        if ( adepting ) {
-            dq.push_back( xt );
-        } else {
-            data.push_back( xt );
+    //! first half of the velocity-Verlet step, needs g0
+    void predict( const BT dt, const BT fr, const BT c ) {
+        const int n = size();
+        for ( unsigned k = 0; k < dim; k++ ) {
+            const BT* __restrict__  m   = alive.data();
+            const BT* __restrict__  x   = xn.component(k);
+            const BT* __restrict__  v   = vn.component(k);
+            const BT* __restrict__  g   = g0.component(k);
+            BT* __restrict__        xp  = xo.component(k);
+            BT* __restrict__        vp  = vo.component(k);
+
+            #pragma omp parallel for
+            for ( int p = 0; p < n; p++ ) {
+                vp[p] += m[p]*( (1.-fr*dt)*v[p] - c*dt*g[p] - vp[p] );
+                xp[p] += m[p]*( x[p] + dt*v[p] - xp[p] );
+            }
         }
-
     }
 
-    void writeVTK ( const std::string path ) const {
-        if (adepting) throw;
-        //Create points and add a vertex at each point. Really what you are doing is adding
-        //cells to the polydata, and the cells only contain 1 element, so they are, by definition,
-        //0-D topology (vertices).
-        vtkSmartPointer<vtkPoints>      points   = vtkSmartPointer<vtkPoints>::New();
-        vtkSmartPointer<vtkCellArray>   vertices = vtkSmartPointer<vtkCellArray>::New();
-        vtkSmartPointer<vtkLine>        line     = vtkSmartPointer<vtkLine>::New();
-        vtkSmartPointer<vtkCellArray>   lines    = vtkSmartPointer<vtkCellArray>::New();
-
-        const double T = 1./std::abs( data.front().t - data.back().t );
-        for ( auto xt = data.begin(); xt != data.end()-1; ++xt ) {
-            //Declare a variable to store the index of the point that gets added. This behaves just like an unsigned int.
-            vtkIdType pid[2];
-
-            //Add a point to the polydata and save its index, which we will use to create the vertex on that point.
-            if ( dim == 2 ) {
-                auto a = *xt;
-                auto b = *(xt+1);
-                pid[0] = points->InsertNextPoint ( a.x(0), a.x(1), T*a.t );
-                pid[1] = points->InsertNextPoint ( b.x(0), b.x(1), T*b.t );
-            } else if ( dim == 3 ) {
-                auto a = *xt;
-                auto b = *(xt+1);
-                pid[0] = points->InsertNextPoint ( a.x(0), a.x(1), a.x(2) );
-                pid[1] = points->InsertNextPoint ( b.x(0), b.x(1), b.x(2) );
-            } else
-                if (adepting) throw;
-
-            //create a vertex cell on the point that was just added.
-            vertices->InsertNextCell(1,pid);
-
-            line->GetPointIds()->SetId(0,pid[0]);
-            line->GetPointIds()->SetId(1,pid[1]);
-            lines->InsertNextCell ( line );
+    //! second half of the velocity-Verlet step, needs g0 and g1
+    void correct( const BT dt, const BT fr, const BT c ) {
+        const int n = size();
+        for ( unsigned k = 0; k < dim; k++ ) {
+            const BT* __restrict__  m   = alive.data();
+            const BT* __restrict__  vp  = vo.component(k);
+            const BT* __restrict__  ga  = g0.component(k);
+            const BT* __restrict__  gb  = g1.component(k);
+            BT* __restrict__        x   = xn.component(k);
+            BT* __restrict__        v   = vn.component(k);
+
+            #pragma omp parallel for
+            for ( int p = 0; p < n; p++ ) {
+                const BT vnew = (1.-.5*fr*dt)*v[p] - .5*c*dt*(ga[p]+gb[p]);
+                v[p] += m[p]*( vnew - v[p] );
+                x[p] += m[p]*( .5*dt*(vp[p]+vnew) );
+            }
         }
-
-        //create a polydata object
-        vtkSmartPointer<vtkPolyData> polydata = vtkSmartPointer<vtkPolyData>::New();
-
-        //set the points and vertices we created as the geometry and topology of the polydata
-        polydata->SetPoints( points   );
-        polydata->SetVerts ( vertices );
-        polydata->SetPolys ( lines    );
-
-        //write the polydata to a file
-        vtkSmartPointer<vtkXMLPolyDataWriter> writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
-        writer->SetFileName ( path.c_str() );
-        writer->SetInput ( polydata );
-        writer->Write();
     }
 };
 
@@ -448,6 +656,8 @@ public:
     typedef typename SetupTraits::EstimationAdaptation   EstimationAdaptation;
     typedef typename SetupTraits::GridAdaptor            GridAdaptor;
     typedef FemLocalEvalOperator< SetupTraits >          FemEvalLOP;
+    typedef FemCoefficientCache< SetupTraits >           CoefficientCache;
+    typedef FemGradientCache< SetupTraits >              GradientCache;
 
 protected:
     GridType&   grid;
@@ -469,6 +679,10 @@ protected:
     LinearProblemSolver             lpSolverL;
     LinearProblemSolver             lpSolverH;
     FemEvalLOP                      fleo;
+    CoefficientCache                coeffs;
+    GradientCache                   grads;
+    bool                            useGradientCache;
+    unsigned                        adaptCycle;         // number of grid adaptations so far
     tree::PointLocator< GridView >  root;
 
 
@@ -490,11 +704,19 @@ public:
         lpSolverL( gos, fieldL, solver, tol ),
         lpSolverH( gos, fieldH, solver, tol ),
         fleo     ( gfs ),
+        coeffs   ( gfs ),
+        grads    ( gfs ),
+        useGradientCache( Traits::constantGradient ),
+        adaptCycle( 0 ),
         root     ( view, false )
     {
+        // affine cells are tested without the grid, kept over the rebuilds
+        root.useCellMaps( true );
     }
 
     void updateDOF( GridAdaptor& gra, const std::vector< FieldU* > field ) {
+        TIMING_SCOPE( "adapt" );
+
         // prepare the grid for refinement
         grid.preAdapt();
 
@@ -521,10 +743,15 @@ public:
         // clean up
         grid.postAdapt();
 
+        // cell indices and coefficients changed
+        invalidateCaches();
+
         std::cout << CE_STATUS <<  "building k-d-Tree ..."<< CE_RESET <<  std::endl;
-        ProfilerStart("rebuild.prof");
-        root.rebuild();
-        ProfilerStop();
+        {
+            profiling::ProfileRegion profile( "rebuild", adaptCycle );
+            root.rebuild();
+        }
+        adaptCycle++;
         std::cout << CE_STATUS <<  "k-d-Tree statistics"<< CE_RESET <<  std::endl;
         root.printTreeStats( std::cout );
     }
@@ -569,6 +796,9 @@ public:
         Dune::PDELab::constraints(bf,gfs,cc);
         for ( auto f : field )
             Dune::PDELab::interpolate( g, gfs, *f );
+
+        // the caches are keyed on the field, not on its values
+        invalidateCaches();
     }
 
     void compute( unsigned maxLevel = 2 ) {
@@ -579,40 +809,71 @@ public:
 
         BCExt                   g( view );
 
+        TIMING_SCOPE( "compute" );
+
         for ( unsigned k = 0; k < maxLevel; k++ ) {
             std::cout << CE_STATUS <<  "Grid information LEVEL "<< k <<  CE_RESET <<  std::endl;
             Dune::gridinfo( grid );
 
             interpolate( g, {&fieldL, &fieldH} );
-            lpSolverL.apply();
+            {
+                TIMING_SCOPE( "solve" );
+                lpSolverL.apply();
+            }
+            invalidateCaches();
             globalRefine( gra, {&fieldL, &fieldH} );
 
             interpolate( g, {&fieldL, &fieldH} );
-            lpSolverH.apply();
+            {
+                TIMING_SCOPE( "solve" );
+                lpSolverH.apply();
+            }
+            invalidateCaches();
             if ( k < maxLevel-1 )
                 localCoarsen( gra, fieldL, {&fieldL, &fieldH} );
         }
 
-        ProfilerStart("integrate.prof");
+        updateCaches( fieldH );
 
-        Timer t;
-        t.tic();
+        {
+            TIMING_SCOPE( "integrate" );
+            profiling::ProfileRegion profile( "integrate" );
 //         #pragma omp parallel for
 //         for ( unsigned k = 0; k < 8; k++ ) {
             integrate( view, fieldH );
 
 //         }
-        t.toc();
-
-        ProfilerStop();
+        }
 
         root.printTreeStats( std::cout );
 //         std::cout << CE_STATUS << "time elapsed " << t.toc() << ",     " <<  t.toc()/omp_get_num_procs() <<  CE_RESET << std::endl;
 
+        benchmarkIntegrators( fieldH );
+        integrateEnsemble( 100000, 10., fieldH );
+
 
         benchmark();
     }
 
+    //! rebuild the evaluation caches of field, call after each solve
+    void updateCaches( const FieldU& field ) {
+        coeffs.update( field );
+        updateGradientCache( field, std::integral_constant<bool, Traits::constantGradient>() );
+    }
+
+    //! drop the evaluation caches, call whenever a cached field is modified in place
+    void invalidateCaches() {
+        coeffs.invalidate();
+        grads.invalidate();
+    }
+
+    void updateGradientCache( const FieldU& field, std::true_type ) {
+        if ( useGradientCache )
+            grads.update( coeffs, field );
+    }
+
+    void updateGradientCache( const FieldU& field, std::false_type ) {}
+
     void writeVTK( std::string path ) {
         DiscreteGridFunction        udgfL( gfs, fieldH );
         Dune::SubsamplingVTKWriter<GridView>   vtkwriterL( view, 2 );
@@ -625,67 +886,351 @@ public:
         vtkwriterH.write( "lo_"+path, Dune::VTKOptions::ascii );
     }
 
-    typename FemLocalEvalOperator< SetupTraits >::Result rhs ( math::ShortVector<typename SetupTraits::Coord, SetupTraits::dimw>& x, const FieldU field ) {
+    typename FemLocalEvalOperator< SetupTraits >::Result rhs ( math::ShortVector<typename SetupTraits::Coord, SetupTraits::dimw>& x, const FieldU& field ) {
         auto e = root.findEntity( x );
-        const auto res = fleo.eval( e.pointer, e.xl, field );
-        return res;
+        if ( grads.isValid( field ) )
+            return grads.eval( x, e.xl, e.index );
+        if ( coeffs.isValid( field ) )
+            return fleo.eval( e.pointer, e.xl, coeffs[e.index] );
+        return fleo.eval( e.pointer, e.xl, field );
     }
 
-    typename FemLocalEvalOperator< SetupTraits >::Result rhs ( Dune::FieldVector<typename SetupTraits::Coord, SetupTraits::dimw>& x, const FieldU field ) {
-        auto e = root.findEntity( asShortVector( x) );
-        const auto res = fleo.eval( e.pointer, e.xl, field );
-        return res;
+    typename FemLocalEvalOperator< SetupTraits >::Result rhs ( Dune::FieldVector<typename SetupTraits::Coord, SetupTraits::dimw>& x, const FieldU& field ) {
+        auto x_ = fem::asShortVector( x );
+        return rhs( x_, field );
     }
 
     void integrate ( typename SetupTraits::GridView& gv, const typename SetupTraits::FieldU& v ) {
-        typedef Dune::FieldVector<typename SetupTraits::Coord, SetupTraits::dimw>   Coord;
-        typedef Dune::FieldVector<typename SetupTraits::Coord, 1>                   Scalar;
         typedef typename SetupTraits::Coord                                         Real;
 
-        Trajectory< Real, Traits::dimw > traj;
+        if ( !coeffs.isValid( fieldH ) ) updateCaches( fieldH );
 
-        Real    dt = .004;                                          // time step
-        Real    fr = .02;                                           // friction
-        math::ShortVector<Real, Traits::dimw> xo( .65 );
-        math::ShortVector<Real, Traits::dimw> xn( .65 );
-        math::ShortVector<Real, Traits::dimw> vo( .07 );
-        math::ShortVector<Real, Traits::dimw> vn( .07 );
-        vo(0) = .0;
-        vn(0) = .0;
+        std::cout << CE_STATUS << "Stream Trajectory to VTK" << CE_RESET << std::endl;
+        io::TrajectoryWriter< Real, Traits::dimw > traj( "traj.vtp", 1 << 16, 1. / 500. );
 
+        math::ShortVector<Real, Traits::dimw> x0( .65 );
+        math::ShortVector<Real, Traits::dimw> v0( .07 );
+        v0(0) = .0;
 
-        Timer t;
-        t.tic();
+        const auto res = integrateVerlet( x0, v0, 500., .004, fieldH, &traj );
+        if ( res.exited )
+            std::cout << CE_ERROR << "Particle left the grid at t = " << res.t << CE_RESET << std::endl;
+
+        std::cout << CE_STATUS << "time elapsed " << res.time <<  CE_RESET << std::endl;
+
+//         root.printTreeStats( std::cout );
+
+        traj.close();
+    }
+
+    //! grad u at x and the diameter of the cell containing x, false if x is outside the grid, needs a valid cache
+    const bool gradient( const math::ShortVector< Coord, Traits::dimw >& x, const FieldU& field,
+                         math::ShortVector< Coord, Traits::dimw >& du, Coord& h ) const {
+        const auto res = root.locate( x );
+        if ( !res.found ) return false;
+
+        h = math::norm( res.entity->_bb.dimension );
+
+        if ( grads.isValid( field ) ) {
+            du = grads.eval( x, res.xl, res.entity->_index ).du;
+        } else {
+            assert( coeffs.isValid( field ) );
+            const typename Traits::EntityPointer ep( grid.entityPointer( res.entity->_seed ) );
+            du = fleo.eval( ep, res.xl, coeffs[res.entity->_index] ).du;
+        }
+
+        return true;
+    }
+
+    //! fixed step velocity-Verlet scheme of integrate(), two locations per step
+    const IntegrationResult< Coord, Traits::dimw > integrateVerlet ( const math::ShortVector< Coord, Traits::dimw >& x0,
+                                                                     const math::ShortVector< Coord, Traits::dimw >& v0,
+                                                                     const Coord tEnd, const Coord dt, const FieldU& field,
+                                                                     io::TrajectoryWriter< Coord, Traits::dimw >* traj = NULL ) const {
+        typedef math::ShortVector< Coord, Traits::dimw > Vec;
+
+        const Coord fr = .02;                                       // friction
+        const Coord c  = .1;                                        // coupling to grad u
+
+        IntegrationResult< Coord, Traits::dimw > res;
+        const double t0 = omp_get_wtime();
 
-        try {
+        Vec xo( x0 ), xn( x0 ), vo( v0 ), vn( v0 ), du0, du1;
+        Coord h;
+        for ( Coord t = 0.; t < tEnd + .1*dt; t+=dt ) {
+            if ( !gradient( xo, field, du0, h ) ) { res.exited = true; break; }
 
-            typename FemLocalEvalOperator<SetupTraits>::Result du0;
-            typename FemLocalEvalOperator<SetupTraits>::Result du1;
-            for ( Real t = 0.; t < 500. + .1*dt; t+=dt ) {
-                du0 = rhs( xo, fieldH );
+            vo = (1.-fr*dt)*vn - c*dt*du0;
+            xo = xn +    dt*vn;
 
-                vo = (1.-fr*dt)*vn - .1*dt*du0.du;
-                xo = xn +    dt*vn;
+            if ( !gradient( xo, field, du1, h ) ) { res.exited = true; break; }
 
-                du1 = rhs( xo, fieldH );
+            vn = (1.-.5*fr*dt)*vn - .5*c*dt*(du0+du1);
+            xn = xn + .5*   dt*(vo+vn);
 
-                vn = (1.-.5*fr*dt)*vn - .5*.1*dt*(du0.du+du1.du);
-                xn = xn + .5*   dt*(vo+vn);
+            res.evals += 2;
+            res.steps++;
+            res.t      = t;
+            if ( traj ) traj->append( xn, t );
+        }
+
+        res.x    = xn;
+        res.time = omp_get_wtime() - t0;
+        return res;
+    }
 
-                traj.push_back( XT<Real, Traits::dimw>(xn, t) );
-//                 std::cout << "\t t = " << t << "\tx = ( " << xn << " )\n";
+    /*
+     * Adaptive embedded Runge-Kutta 3(2) (Bogacki-Shampine, first same as last) for
+     * x' = v, v' = -fr v - c grad u(x). The local error is controlled to tol (absolute and
+     * relative), additionally a step may not move the particle by more than cfl times the
+     * diameter of its current cell, so no cell is skipped in regions of large gradients.
+     */
+    const IntegrationResult< Coord, Traits::dimw > integrateAdaptive ( const math::ShortVector< Coord, Traits::dimw >& x0,
+                                                                       const math::ShortVector< Coord, Traits::dimw >& v0,
+                                                                       const Coord tEnd, const Coord tol, const Coord cfl,
+                                                                       const FieldU& field,
+                                                                       io::TrajectoryWriter< Coord, Traits::dimw >* traj = NULL ) const {
+        typedef math::ShortVector< Coord, Traits::dimw > Vec;
+
+        const Coord fr      = .02;                                  // friction
+        const Coord c       = .1;                                   // coupling to grad u
+        const Coord safety  = .9;
+        const Coord facmin  = .2;
+        const Coord facmax  = 5.;
+        const Coord dtmin   = 1e-10*tEnd;
+
+        IntegrationResult< Coord, Traits::dimw > res;
+        const double t0 = omp_get_wtime();
+
+        Vec x( x0 ), v( v0 ), g1, g2, g3, g4;
+        Coord h1, h2, h3, h4;
+
+        res.x = x;
+        if ( !gradient( x, field, g1, h1 ) ) {
+            res.exited = true;
+            res.time   = omp_get_wtime() - t0;
+            return res;
+        }
+        res.evals++;
+
+        Coord t  = 0.;
+        Coord dt = tEnd;
+        while ( t < tEnd ) {
+            // step size limiter from the local cell diameter
+            dt = std::min( dt, tEnd - t );
+            const Coord speed = math::norm( v );
+            if ( speed > 0. ) dt = std::min( dt, cfl*h1/speed );
+
+            const Vec kx1 = v;
+            const Vec kv1 = -fr*v - c*g1;
+
+            const Vec x2  = x + .5*dt*kx1;
+            const Vec v2  = v + .5*dt*kv1;
+            res.evals++;
+            if ( !gradient( x2, field, g2, h2 ) ) {
+                res.rejected++;
+                dt *= .5;
+                if ( dt < dtmin ) { res.exited = true; break; }
+                continue;
+            }
+            const Vec kx2 = v2;
+            const Vec kv2 = -fr*v2 - c*g2;
+
+            const Vec x3  = x + .75*dt*kx2;
+            const Vec v3  = v + .75*dt*kv2;
+            res.evals++;
+            if ( !gradient( x3, field, g3, h3 ) ) {
+                res.rejected++;
+                dt *= .5;
+                if ( dt < dtmin ) { res.exited = true; break; }
+                continue;
+            }
+            const Vec kx3 = v3;
+            const Vec kv3 = -fr*v3 - c*g3;
+
+            const Vec xn  = x + dt*( (2./9.)*kx1 + (1./3.)*kx2 + (4./9.)*kx3 );
+            const Vec vn  = v + dt*( (2./9.)*kv1 + (1./3.)*kv2 + (4./9.)*kv3 );
+            res.evals++;
+            if ( !gradient( xn, field, g4, h4 ) ) {
+                res.rejected++;
+                dt *= .5;
+                if ( dt < dtmin ) { res.exited = true; break; }
+                continue;
             }
+            const Vec kx4 = vn;
+            const Vec kv4 = -fr*vn - c*g4;
 
-        } catch ( GridError& err ) {
-            std::cout << CE_ERROR << err.what() << CE_RESET << std::endl;
+            // embedded second order error estimate
+            const Vec ex  = dt*( (-5./72.)*kx1 + (1./12.)*kx2 + (1./9.)*kx3 - (1./8.)*kx4 );
+            const Vec ev  = dt*( (-5./72.)*kv1 + (1./12.)*kv2 + (1./9.)*kv3 - (1./8.)*kv4 );
+
+            Coord err = 0.;
+            for ( unsigned k = 0; k < Traits::dimw; k++ ) {
+                err = std::max( err, std::abs(ex(k))/(tol*(1. + std::max(std::abs(x(k)), std::abs(xn(k))))) );
+                err = std::max( err, std::abs(ev(k))/(tol*(1. + std::max(std::abs(v(k)), std::abs(vn(k))))) );
+            }
+
+            if ( err <= 1. ) {
+                t  += dt;
+                x   = xn;
+                v   = vn;
+                g1  = g4;
+                h1  = h4;
+                res.steps++;
+                if ( traj ) traj->append( x, t );
+            } else
+                res.rejected++;
+
+            dt *= ( err > 0. ) ? std::min( facmax, std::max( facmin, safety*std::pow( err, -1./3. ) ) ) : facmax;
         }
 
-        std::cout << CE_STATUS << "time elapsed " << t.toc() <<  CE_RESET << std::endl;
+        res.x    = x;
+        res.t    = t;
+        res.time = omp_get_wtime() - t0;
+        return res;
+    }
+
+    //! steps, locations and wall time of the fixed step and the adaptive scheme against a tight tolerance reference
+    void benchmarkIntegrators( const FieldU& field, const Coord tEnd = 50. ) {
+        typedef math::ShortVector< Coord, Traits::dimw > Vec;
+
+        if ( !coeffs.isValid( field ) ) updateCaches( field );
+
+        Vec x0( .65 );
+        Vec v0( .07 );
+        v0(0) = .0;
+
+        const auto ref = integrateAdaptive( x0, v0, tEnd, 1e-10, .1, field );
+        std::cout << CE_STATUS << "Integrator benchmark, reference " << ref.x << " at t = " << ref.t
+                  << ( ref.exited ? " (left the grid)" : "" ) << CE_RESET << std::endl;
+        std::cout << "scheme      parameter    steps   rejected      evals       time      error" << std::endl;
+
+        auto print = [&]( const std::string& name, const Coord param, const IntegrationResult< Coord, Traits::dimw >& r ) {
+            std::cout << std::setw(8)  << name            << "  "
+                      << std::setw(11) << param           << "  "
+                      << std::setw(7)  << r.steps         << "  "
+                      << std::setw(9)  << r.rejected      << "  "
+                      << std::setw(9)  << r.evals         << "  "
+                      << std::setw(9)  << r.time          << "  "
+                      << std::setw(9)  << math::norm( r.x - ref.x )
+                      << ( r.exited ? "  (left the grid)" : "" ) << std::endl;
+        };
+
+        for ( const Coord dt : { .016, .008, .004, .002 } )
+            print( "verlet", dt, integrateVerlet( x0, v0, tEnd, dt, field ) );
+
+        for ( const Coord tol : { 1e-3, 1e-4, 1e-5, 1e-6, 1e-7 } )
+            print( "rk32", tol, integrateAdaptive( x0, v0, tEnd, tol, 1., field ) );
+    }
 
-//         root.printTreeStats( std::cout );
+    //! buffers of evalEnsemble, kept between the steps
+    struct EnsembleScratch {
+        typename tree::PointLocator< GridView >::BatchResult::Points    x;      //!> positions of the alive particles
+        std::vector< int >                                              id;     //!> their index in the ensemble
+        typename tree::PointLocator< GridView >::BatchResult            hits;
+    };
+
+    /**
+     * grad u at the positions x of all alive particles into g, particles outside the grid are
+     * retired at time t. The alive particles are located as one batch, split along the curve
+     * into one part per thread if the locator keeps the affine maps of the cells. The gradient
+     * cache needs only loads, the coefficient cache takes the inverse Jacobian from the maps,
+     * so no thread reads the grid. Without the maps the coefficient cache falls back to the
+     * geometries of the grid on the calling thread.
+     */
+    void evalEnsemble( ParticleEnsemble< Coord, Traits::dimw >& pe,
+                       const math::ShortVectorArray< Coord, Traits::dimw >& x,
+                       math::ShortVectorArray< Coord, Traits::dimw >& g,
+                       const FieldU& field, const Coord t, EnsembleScratch& s ) const {
+        assert( grads.isValid( field ) || coeffs.isValid( field ) );
+        const int n = pe.size();
+
+        s.id.clear();
+        for ( int p = 0; p < n; p++ )
+            if ( pe.alive[p] != 0. ) s.id.push_back( p );
+
+        const int na = s.id.size();
+        s.x.resize( na );
+        for ( int i = 0; i < na; i++ )
+            s.x.set( i, x.get( s.id[i] ) );
+        root.locateParallel( s.x, s.hits );
+
+        const auto retire = [&]( const int p ) {
+            pe.alive[p] = 0.;
+            pe.tExit[p] = t;
+            g.set( p, math::ShortVector< Coord, Traits::dimw >( 0. ) );
+        };
+
+        if ( grads.isValid( field ) ) {
+            #pragma omp parallel for schedule(dynamic, 256)
+            for ( int i = 0; i < na; i++ ) {
+                const int  p = s.id[i];
+                const auto e = s.hits.entity[i];
+                if ( e == NULL ) { retire( p ); continue; }
+                g.set( p, grads.eval( x.get( p ), fem::asFieldVector( s.hits.xl, i ), e->_index ).du );
+            }
+            return;
+        }
+
+        if ( root.hasCellMaps() ) {
+            // the finite element maps of the setup traits return one element for all cells
+            const auto& fe = fleo.finiteElement( *view.template begin<0>() );
+
+            #pragma omp parallel for schedule(dynamic, 256)
+            for ( int i = 0; i < na; i++ ) {
+                const int  p = s.id[i];
+                const auto e = s.hits.entity[i];
+                if ( e == NULL ) { retire( p ); continue; }
+                g.set( p, fleo.eval( fe, fem::asFieldVector( s.hits.xl, i ), coeffs[e->_index], root.cellMap( e ).jinv ).du );
+            }
+            return;
+        }
+
+        for ( int i = 0; i < na; i++ ) {
+            const int  p = s.id[i];
+            const auto e = s.hits.entity[i];
+            if ( e == NULL ) { retire( p ); continue; }
+            const typename Traits::EntityPointer ep( grid.entityPointer( e->_seed ) );
+            g.set( p, fleo.eval( ep, fem::asFieldVector( s.hits.xl, i ), coeffs[e->_index] ).du );
+        }
+    }
+
+    //! advance n particles with the scheme of integrate() until tEnd or until all have left the domain
+    void integrateEnsemble ( const unsigned n, const Coord tEnd, const FieldU& field ) {
+        if ( !coeffs.isValid( field ) ) updateCaches( field );
+
+        const Coord dt = .004;                                      // time step
+        const Coord fr = .02;                                       // friction
+        const Coord c  = .1;                                        // coupling to grad u
+
+        ParticleEnsemble< Coord, Traits::dimw > pe( n );
+        for ( unsigned p = 0; p < n; p++ ) {
+            for ( unsigned k = 0; k < Traits::dimw; k++ ) {
+                pe.xn(p,k) = .9*(2.*drand48()-1.);
+                pe.xo(p,k) = pe.xn(p,k);
+                pe.vn(p,k) = (k == 0) ? 0. : .07;
+                pe.vo(p,k) = pe.vn(p,k);
+            }
+        }
+
+        std::cout << CE_STATUS << "Integrate ensemble of " << n << " particles" << CE_RESET << std::endl;
+
+        EnsembleScratch s;
+        const double t0 = omp_get_wtime();
+        unsigned steps = 0;
+        for ( Coord t = 0.; t < tEnd + .1*dt; t+=dt, steps++ ) {
+            evalEnsemble( pe, pe.xo, pe.g0, field, t, s );
+            pe.predict( dt, fr, c );
+            evalEnsemble( pe, pe.xo, pe.g1, field, t, s );
+            pe.correct( dt, fr, c );
+
+            if ( (steps % 100 == 0) && (pe.numAlive() == 0) ) break;
+        }
+        const double t1 = omp_get_wtime();
 
-        std::cout << CE_STATUS << "Write Trajectory to VTK" << CE_RESET << std::endl;
-        traj.writeVTK( "traj.vtp" );
+        std::cout << CE_STATUS << "time elapsed " << t1 - t0 << ",   steps " << steps
+                  << ",   particle steps/s " << static_cast<double>(n)*steps/(t1 - t0)
+                  << ",   alive " << pe.numAlive() << "/" << n << CE_RESET << std::endl;
     }
 
     
@@ -718,6 +1263,19 @@ public:
         }
         const Real ta = t.toc();
         std::cout << ta << std::endl;
+
+        // the same queries as batches, one query at a time and with 16 interleaved queries in flight
+        typename tree::PointLocator< GridView >::BatchResult::Points xb;
+        typename tree::PointLocator< GridView >::BatchResult         rb;
+        math::gather( lv, xb );
+        for ( const unsigned group : { 1u, 16u } ) {
+            std::cout << CE_STATUS << "kd-tree batch, " << group << " in flight " << CE_RESET;
+            t.tic();
+            for ( unsigned l = 0; l < nL; l++ )
+                root.locate( xb, rb, false, group );
+            const Real tg = t.toc();
+            std::cout << tg << "   SPEED-UP " << ta/tg << "x" << std::endl;
+        }
         std::cout << CE_STATUS << "hr-tree " << CE_RESET;
         t.tic();
         for ( unsigned l = 0; l < nL/200; l++ ) {
@@ -730,8 +1288,77 @@ public:
             }
         }
         const Real tb = t.toc();
-        std::cout << ta << std::endl;
+        std::cout << tb << std::endl;
         std::cout << CE_STATUS << "SPEED-UP  " << CE_RESET << 200.*tb/ta << "x" << std::endl;
+
+        // locate + evaluate, coefficients gathered through the DOF mapping vs. read from the cache
+        if ( !coeffs.isValid( fieldH ) ) updateCaches( fieldH );
+        std::cout << CE_STATUS << "coefficient cache " << CE_RESET << coeffs.memory() << " bytes, "
+                  << static_cast<Real>(coeffs.memory())/static_cast<Real>(view.size(0)) << " bytes/cell" << std::endl;
+
+        Real ua = 0.;
+        std::cout << CE_STATUS << "eval vread " << CE_RESET;
+        t.tic();
+        for ( unsigned l = 0; l < nL; l++ ) {
+            for ( unsigned k = 0; k < nV; k++ ) {
+                auto ed = root.findEntity( lv[k] );
+                ua += fleo.eval( ed.pointer, ed.xl, fieldH ).u;
+            }
+        }
+        const Real tc = t.toc();
+        std::cout << tc << std::endl;
+
+        Real ub = 0.;
+        std::cout << CE_STATUS << "eval cache " << CE_RESET;
+        t.tic();
+        for ( unsigned l = 0; l < nL; l++ ) {
+            for ( unsigned k = 0; k < nV; k++ ) {
+                auto ed = root.findEntity( lv[k] );
+                ub += fleo.eval( ed.pointer, ed.xl, coeffs[ed.index] ).u;
+            }
+        }
+        const Real td = t.toc();
+        std::cout << td << std::endl;
+        std::cout << CE_STATUS << "SPEED-UP  " << CE_RESET << tc/td << "x" << ((ua == ub) ? "" : "   (results differ!)") << std::endl;
+
+        if ( grads.isValid( fieldH ) ) {
+            std::cout << CE_STATUS << "gradient cache " << CE_RESET << grads.memory() << " bytes" << std::endl;
+            std::cout << CE_STATUS << "eval gradient " << CE_RESET;
+            t.tic();
+            for ( unsigned l = 0; l < nL; l++ ) {
+                for ( unsigned k = 0; k < nV; k++ ) {
+                    auto ed = root.findEntity( lv[k] );
+                    ub += grads.eval( lv[k], ed.xl, ed.index ).u;
+                }
+            }
+            const Real te = t.toc();
+            std::cout << te << std::endl;
+            std::cout << CE_STATUS << "SPEED-UP  " << CE_RESET << tc/te << "x" << std::endl;
+        }
+
+        // locate + evaluate must not touch the heap once the scratch space is set up
+        const auto evalAll = [&]( const unsigned k ) {
+            auto ed = root.findEntity( lv[k % nV] );
+            ub += fleo.eval( ed.pointer, ed.xl, fieldH ).u;
+            ub += fleo.eval( ed.pointer, ed.xl, coeffs[ed.index] ).u;
+            if ( grads.isValid( fieldH ) )
+                ub += grads.eval( lv[k % nV], ed.xl, ed.index ).u;
+        };
+
+        // warm up, the local function space and the local vector of the vread reach their size
+        for ( unsigned k = 0; k < nV; k++ )
+            evalAll( k );
+
+        const unsigned nA = 1000000;
+        alloc::AllocationCounter count;
+        for ( unsigned k = 0; k < nA; k++ )
+            evalAll( k );
+        const unsigned long allocs = count.allocations();
+        if ( allocs > 0 ) {
+            std::cout << CE_ERROR << allocs << " heap allocations in " << nA << " evaluations" << CE_RESET << std::endl;
+            throw std::runtime_error( "Point queries and evaluation allocated heap memory" );
+        }
+        std::cout << CE_STATUS << "No heap allocations in " << nA << " evaluations" << CE_RESET << std::endl;
     }
 
 };
@@ -758,43 +1385,56 @@ inline void compute() {
 
     std::cout << CE_STATUS <<  "Write solution to VTK\n" <<  CE_RESET;
     femTest.writeVTK( "hang_test" );
+
+    if ( timing::enabled ) {
+        std::cout << CE_STATUS <<  "Timing summary" <<  CE_RESET << std::endl;
+        timing::Registry::instance().print( std::cout );
+        timing::Registry::instance().writeCSV ( "timing.csv"  );
+        timing::Registry::instance().writeJSON( "timing.json" );
+    }
 }
 
 
 
 int main ( int argc, char **argv ) {
     Dune::MPIHelper::instance( argc, argv );
+    profiling::Profiler::instance().configure( argc, argv );
 
     srand((unsigned)std::time(NULL));
 
     std::cout.setf( std::ios::scientific );
     std::cout.precision( 4 );
 
+    // discretization, -p1d3 unless given on the command line
+    std::string disc( "-p1d3" );
+    for ( int k = 1; k < argc; k++ ) {
+        const std::string arg( argv[k] );
+        if ( arg == "--profile" ) { k++; continue; }
+        disc = arg;
+    }
+
     try {
-// #define USE_CMD_PARAM
-#ifdef USE_CMD_PARAM
-        if ( (argc < 1) || (std::string(argv[1]) == "-p1d2") ) {
-#endif
-            typedef ALUSimplexP1Traits< double, 3, FemLocalOperator, FemFunctionOperator>   SetupTraits;
+        if ( disc == "-p1d2" ) {
+            typedef ALUSimplexP1Traits< double, 2, FemLocalOperator, FemFunctionOperator>   SetupTraits;
             compute< SetupTraits >();
-#ifdef USE_CMD_PARAM
-        } else if (std::string(argv[1]) == "-p1d3") {
+        } else if ( disc == "-p1d3" ) {
             typedef ALUSimplexP1Traits< double, 3, FemLocalOperator, FemFunctionOperator>   SetupTraits;
             compute< SetupTraits >();
-        } else if (std::string(argv[1]) == "-q1d2") {
+        } else if ( disc == "-q1d2" ) {
             typedef ALUCubeQ1Traits< double, 2, FemLocalOperator, FemFunctionOperator>      SetupTraits;
             compute< SetupTraits >();
-        } else if (std::string(argv[1]) == "-q1d3") {
+        } else if ( disc == "-q1d3" ) {
             typedef ALUCubeQ1Traits< double, 3, FemLocalOperator, FemFunctionOperator>      SetupTraits;
             compute< SetupTraits >();
-        } else if ((std::string(argv[1]) == "-h") || (std::string(argv[1]) == "--help")) {
+        } else {
             std::cout << "Test program using DUNE" << std::endl;
             std::cout << std::endl;
-            std::cout << "-p1           Simplex P1-fem (default)" << std::endl;
-            std::cout << "-q1           Cube    Q1-fem"           << std::endl;
-            std::cout << "-h, --help    This help."               << std::endl << std::endl;
+            std::cout << "-p1d2, -p1d3      Simplex P1-fem in 2d, 3d (default -p1d3)" << std::endl;
+            std::cout << "-q1d2, -q1d3      Cube    Q1-fem in 2d, 3d"                 << std::endl;
+            std::cout << "--profile <spec>  profiled regions, see utils/profiler.hpp"  << std::endl;
+            std::cout << "-h, --help        This help."                                << std::endl << std::endl;
+            return ( (disc == "-h") || (disc == "--help") ) ? 0 : 1;
         }
-#endif
 
     } catch ( std::exception & e) {
         std::cout << " STL ERROR : " << e.what () << std::endl;
@@ -43,6 +43,7 @@
 
 #include <utils/utils.hpp>
 #include <math/shortvector.hpp>
+#include <math/shortvectorarray.hpp>
 
 #include <fem/dune.h>
 #include <fem/helper.hpp>
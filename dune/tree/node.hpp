@@ -33,11 +33,15 @@
 #pragma once
 
 #include <limits>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <error/duneerror.hpp>
 #include <utils/utils.hpp>
 #include <geometry/boundingbox.hpp>
+#include <tree/querystats.hpp>
+#include <tree/traversal.hpp>
 #include <assert.h>
 #include <fem/dune.h>
 
@@ -133,9 +137,9 @@ protected:
     const GridView&                 _gridView;
     const GridType&                 _grid;
     BoundingBox                     _bounding_box;
-    LinaVector                      _normal;            //!> the normal of the plane that splits this node
     unsigned                        _orientation;       //!> the dimension that is split by this node
     unsigned                        _level;             //!> the depth of the node in the tree
+    unsigned                        _leafSize;          //!> nodes with at most this many vertices are not split
     bool                            _isLeaf;
     bool                            _isEmpty;
     bool                            _balanced;
@@ -155,14 +159,13 @@ protected:
         _gridView(gv),
         _grid(_gridView.grid()),
         _orientation(0),
-        _normal(0.),
         _level(0),
+        _leafSize(1),
         _isLeaf(false),
         _isEmpty(true),
         _balanced( bal ), 
         _balance_factor(0)
     {
-        _normal(_orientation) = 1.;
     }
     
     //Only needed for Nodes themselfs!
@@ -171,8 +174,8 @@ protected:
         _gridView(parent->_gridView),
         _grid(_gridView.grid()),
         _level(level),
+        _leafSize(parent->_leafSize),
         _bounding_box(box),
-        _normal(0.),
         _orientation(ori%dim),
         _child( {NULL, NULL} ),
         _median(0.),
@@ -180,8 +183,7 @@ protected:
         _isEmpty(true),
         _balanced(bal)
     {
-        _normal( _orientation ) = 1.;
-        if ( level > 1000 ) throw GridError( "Tree depth > 1000!", __ERROR_INFO__ );
+        if ( level > MAX_TREE_DEPTH ) throw GridError( "Tree depth exceeds MAX_TREE_DEPTH, are there duplicate vertices?", __ERROR_INFO__ );
     }
     
     //== build tree =====================================================================================
@@ -203,8 +205,8 @@ protected:
         _vertices.shrink_to_fit();
 
         _isEmpty = _vertices.size() <  1;
-        _isLeaf  = _vertices.size() == 1;
-        // abort the recursion if there is only one vertex left within this node
+        _isLeaf  = !_isEmpty && (_vertices.size() <= _leafSize);
+        // abort the recursion if at most _leafSize vertices are left within this node
         if ( _isLeaf || _isEmpty ) return;
 
         _median = _bounding_box.corner(_orientation) + .5*_bounding_box.dimension(_orientation);
@@ -230,8 +232,8 @@ protected:
         _vertices.shrink_to_fit();
         
         _isEmpty = _vertices.size() <  1;
-        _isLeaf  = _vertices.size() == 1;
-        // abort the recursion if there is only one vertex left within this node
+        _isLeaf  = !_isEmpty && (_vertices.size() <= _leafSize);
+        // abort the recursion if at most _leafSize vertices are left within this node
         if ( _isLeaf || _isEmpty ) return;
             
         _median = _bounding_box.corner(_orientation) + .5*_bounding_box.dimension(_orientation);
@@ -251,8 +253,8 @@ protected:
         _vertices.shrink_to_fit();
         
         _isEmpty = _vertices.size() <  1;
-        _isLeaf  = _vertices.size() == 1;
-        // abort the recursion if there is only one vertex left within this node
+        _isLeaf  = !_isEmpty && (_vertices.size() <= _leafSize);
+        // abort the recursion if at most _leafSize vertices are left within this node
         if ( _isLeaf || _isEmpty ) return;
             
         _median = _bounding_box.corner(_orientation) + .5*_bounding_box.dimension(_orientation);
@@ -389,12 +391,14 @@ protected:
             if ( (!(_child[0]->_child[0])) && (_child[0]->_child[1]) ) {
                 auto aux    = _child[0];
                 _child[0]   = aux->_child[1];
+                _child[0]->_parent = this;
                 aux->_child[1] = NULL;
                 safe_delete( aux );
             } 
             if ( (!(_child[0]->_child[1])) && (_child[0]->_child[0]) ) {
                 auto aux    = _child[0];
                 _child[0]   = aux->_child[0];
+                _child[0]->_parent = this;
                 aux->_child[0] = NULL;
                 safe_delete( aux );
             }
@@ -404,12 +408,14 @@ protected:
             if ( (!(_child[1]->_child[0])) && (_child[1]->_child[1]) ) {
                 auto aux    = _child[1];
                 _child[1]   = aux->_child[1];
+                _child[1]->_parent = this;
                 aux->_child[1] = NULL;
                 safe_delete( aux );
             } 
             if ( (!(_child[1]->_child[1])) && (_child[1]->_child[0]) ) {
                 auto aux    = _child[1];
                 _child[1]   = aux->_child[0];
+                _child[1]->_parent = this;
                 aux->_child[0] = NULL;
                 safe_delete( aux );
             }
@@ -420,6 +426,41 @@ protected:
 // public data
 //=======================================================================================================
 public:
+    //! bytes requested from the allocator by the parts of a point locator
+    struct MemoryStats {
+        std::size_t tree;           //!> Node objects and their vertex lists, the point locator releases them after the build
+        std::size_t nodes;          //!> flat or packed nodes searched by the queries
+        std::size_t leafCells;      //!> cell lists of the leafs
+        std::size_t leafVertices;   //!> vertex ranges of the leafs
+        std::size_t cullBoxes;      //!> boxes of the cells
+        std::size_t cellMaps;       //!> affine maps of the cells, if the point locator keeps them
+        std::size_t entities;       //!> entity containers and the pointers to them
+        std::size_t vertices;       //!> vertex containers
+        std::size_t adjacency;      //!> cells of each vertex
+        std::size_t idMaps;         //!> maps from global ids to indices
+
+        MemoryStats() : tree(0), nodes(0), leafCells(0), leafVertices(0), cullBoxes(0), cellMaps(0), entities(0), vertices(0), adjacency(0), idMaps(0) {}
+
+        const std::size_t total() const {
+            return tree + nodes + leafCells + leafVertices + cullBoxes + cellMaps + entities + vertices + adjacency + idMaps;
+        }
+
+        std::ostream& operator<< ( std::ostream& out ) const {
+            out << "Bytes of the pointer tree           " << tree               << std::endl;
+            out << "Bytes of the search nodes           " << nodes              << std::endl;
+            out << "Bytes of the cell lists of leafs    " << leafCells          << std::endl;
+            out << "Bytes of the vertex ranges of leafs " << leafVertices       << std::endl;
+            out << "Bytes of the cull boxes             " << cullBoxes          << std::endl;
+            out << "Bytes of the affine cell maps       " << cellMaps           << std::endl;
+            out << "Bytes of the entity containers      " << entities           << std::endl;
+            out << "Bytes of the vertex containers      " << vertices           << std::endl;
+            out << "Bytes of the vertex adjacency       " << adjacency          << std::endl;
+            out << "Bytes of the id maps                " << idMaps             << std::endl;
+            out << "Bytes in total                      " << total()            << std::endl;
+            return out;
+        }
+    };
+
     struct TreeStats {
         unsigned depth;
         
@@ -445,6 +486,9 @@ public:
         Real     aveEntitiesPerLeaf;
         unsigned maxEntitiesPerLeaf;
 
+        MemoryStats     memory;         //!> only filled by the point locator
+        QueryStatistics queries;        //!> only filled with -DENABLE_QUERY_STATS
+
         TreeStats() :
             depth( 0 ),
             numNodes( 0 ),
@@ -490,27 +534,38 @@ public:
             out << "Average number of Entities per Leaf " << aveEntitiesPerLeaf << std::endl;
             out << "Maximum number of Entities per Leaf " << maxEntitiesPerLeaf << std::endl;
 
+            if ( memory.total() > 0 ) {
+                out << std::endl;
+                memory.operator<<(out);
+            }
+
+            if ( queries.queries > 0 ) {
+                out << std::endl;
+                queries.operator<<(out);
+            }
+
             return out;
         }
     };
     
-    struct DepthFirstResult {
-        const EntitySeed    es;
-        const FieldVector   xl;
-        const bool          found;
-
-        DepthFirstResult() : es(), xl(0.), found(false) {}
-        DepthFirstResult( const EntitySeed& es_, const FieldVector& xl_ ) : es(es_), xl(xl_), found(true) {}
-        DepthFirstResult( const DepthFirstResult& r ) : es(r.es), xl(r.xl), found(r.found) {}
-    };
-
     struct EntityContainer {
         EntitySeed                      _seed;
         geometry::BoundingBox<Real,dim> _bb;
         LinaVector                      _global;
         unsigned                        _id;
+        unsigned                        _index;     //!> index of the entity in the grid view's index set
 
-        EntityContainer( const EntitySeed& seed ) : _seed(seed), _bb(), _global(0.), _id(0) {}
+        EntityContainer( const EntitySeed& seed ) : _seed(seed), _bb(), _global(0.), _id(0), _index(0) {}
+    };
+
+    struct DepthFirstResult {
+        const EntityContainer* const    entity;
+        const FieldVector               xl;
+        const bool                      found;
+
+        DepthFirstResult() : entity(NULL), xl(0.), found(false) {}
+        DepthFirstResult( const EntityContainer* entity_, const FieldVector& xl_ ) : entity(entity_), xl(xl_), found(true) {}
+        DepthFirstResult( const DepthFirstResult& r ) : entity(r.entity), xl(r.xl), found(r.found) {}
     };
 
     const Node*             child (const unsigned i)    const { return _child[i]; }
@@ -521,7 +576,8 @@ public:
     const bool              balanced()                  const { return _balanced;    }
     const unsigned          level()                     const { return _level;      }
     const unsigned          orientation()               const { return _orientation;}
-    const LinaVector        normal()                    const { return _normal;     }
+    const unsigned          leafSize()                  const { return _leafSize;   }
+    const Real              median()                    const { return _median;     }
     
 //=======================================================================================================
 // public methods
@@ -549,6 +605,14 @@ public:
     }
     
     //== information on tree ============================================================================
+    //! bytes of the nodes below this one and of the vertex lists of all
+    const std::size_t treeMemory() const {
+        std::size_t m = _vertices.capacity()*sizeof(VertexContainer*);
+        for ( unsigned c = 0; c < 2; c++ )
+            if ( _child[c] ) m += sizeof(Node) + _child[c]->treeMemory();
+        return m;
+    }
+
     virtual void fillTreeStats( TreeStats& ts ) const {
         ts.minLevel = std::min( ts.minLevel , _level );
         ts.maxLevel = std::max( ts.maxLevel , _level );
@@ -574,8 +638,11 @@ public:
             ts.aveLeafLevel += static_cast<Real>(_level);
 
             if ( vs > 0 ) {
-//                 assert( vs == 1 );
-                const unsigned    vss  = _vertices[0]->_entity_seeds.size();
+                std::vector<unsigned> cells;
+                for ( const auto v : _vertices )
+                    cells.insert( cells.end(), v->_entity_seeds.begin(), v->_entity_seeds.end() );
+                std::sort( cells.begin(), cells.end() );
+                const unsigned    vss  = std::unique( cells.begin(), cells.end() ) - cells.begin();
                 ts.minEntitiesPerLeaf  = std::min( ts.minEntitiesPerLeaf , vss );
                 ts.maxEntitiesPerLeaf  = std::max( ts.maxEntitiesPerLeaf , vss );
                 ts.aveEntitiesPerLeaf += static_cast<Real>( vss );
@@ -588,55 +655,15 @@ public:
 
     
     //== search / iterate tree  =========================================================================
+    //! leaf whose region contains x, the point locator searches its flat copy of the tree instead
     const Node* searchDown( const LinaVector& x ) const {
-        if ( _isLeaf ) return this;
-
-        if ( left(x) ) return _child[0]->searchDown(x);
-        return _child[1]->searchDown(x);
-    }
-
-    const DepthFirstResult  searchUp( const FieldVector& xg, const std::vector<EntityContainer*>& _entities, const Node* caller = NULL ) const {
-        const auto res = searchDown( xg, _entities, caller );
-        if ( res.found ) return res;
-
-        if ( _parent != NULL )
-            return _parent->searchUp( xg, _entities, this );
-
-        return DepthFirstResult( );
-    }
-
-    const DepthFirstResult  searchDown( const FieldVector& xg, const std::vector<EntityContainer*>& _entities, const Node* caller = NULL ) const {
-        if ( _isEmpty ) return DepthFirstResult( );
-
-        if ( _isLeaf  ) {
-            LinaVector x;
-            for ( unsigned k = 0; k < dim; k++)
-                x(k) = xg[k];
-
-            for ( auto es = vertex(0)->_entity_seeds.begin(); es != vertex(0)->_entity_seeds.end(); ++es ) {
-                if ( !_entities[*es]->_bb.isInside(x) ) continue;
-                const EntityPointer ep( _grid.entityPointer( _entities[*es]->_seed ) );
-                const Entity&   e   = *ep;
-                const auto&     geo = e.geometry();
-                const auto&     gre = Dune::GenericReferenceElements< Real, dim >::general(geo.type());
-                const auto      xl  = geo.local( xg );
-                if ( gre.checkInside( xl ) ) {
-                    return DepthFirstResult( e.seed(), xl );
-                }
-            }
-
-        } else {
-            if ( (caller != _child[0]) && _child[0] ) {
-                const auto res0 = _child[0]->searchDown( xg, _entities, this );
-                if ( res0.found ) return res0;
-            }
-            if ( (caller != _child[1]) && _child[1] ) {
-                const auto res1 = _child[1]->searchDown( xg, _entities, this );
-                if ( res1.found ) return res1;
-            }
+        const Node* n = this;
+        for ( ;; ) {
+            QUERY_STATS( QueryCounters::current().descended++ );
+            if ( n->_isLeaf ) return n;
+            const unsigned c = n->left(x) ? 0 : 1;
+            n = n->_child[c] ? n->_child[c] : n->_child[1-c];
         }
-
-        return DepthFirstResult( );
     }
     
     
@@ -0,0 +1,101 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Compressed node of the point locator's search tree.
+ *
+ * A PackedNode takes 8 bytes instead of the 20 to 24 of a flat node. The split is stored as
+ * a 16 bit fraction of the node's box. The box itself is not stored, it follows from the box
+ * of the root and the splits on the path, just like BoundingBox::split derives the boxes of
+ * the children. The child placed first in memory directly follows its parent, only the
+ * other one needs a 32 bit index.
+ */
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace tree {
+
+//! layout of the nodes the point locator searches
+enum class NodeFormat { Flat, Packed };
+
+inline const std::string asString( const NodeFormat f ) {
+    return ( f == NodeFormat::Packed ) ? "packed" : "flat";
+}
+
+
+struct PackedNode {
+    static constexpr unsigned LEAF      = 3;        //<! in the axis bits
+    static constexpr unsigned LEFT      = 4;        //<! child 0 exists
+    static constexpr unsigned RIGHT     = 8;        //<! child 1 exists
+    static constexpr unsigned SWAPPED   = 16;       //<! child 1 is placed first
+    static constexpr unsigned SCALE     = 1u << 16;
+    static constexpr unsigned NONE      = std::numeric_limits<unsigned>::max();
+
+    uint32_t    index;      //<! inner nodes: the child placed second, leafs: first cell in the cell lists
+    uint16_t    split;      //<! inner nodes: split in units of 1/SCALE of the box, leafs: number of cells
+    uint16_t    info;       //<! split axis or LEAF in the lowest two bits, then LEFT, RIGHT and SWAPPED
+
+    const bool     isLeaf() const                 { return (info & 3) == LEAF; }
+    const unsigned axis()   const                 { return info & 3; }
+    const bool     has( const unsigned c ) const  { return info & ( LEFT << c ); }
+
+    //! index of child c of this node, stored at n, NONE if missing
+    const unsigned child( const unsigned n, const unsigned c ) const {
+        if ( !has(c) ) return NONE;
+        const unsigned placedFirst = ( info & SWAPPED ) ? 1 : 0;
+        return ( (c == placedFirst) || !has(1-c) ) ? n+1 : index;
+    }
+
+    //! position of a split between lower and upper, the descent and the encoding use the same arithmetic
+    template< typename T >
+    static inline T position( const T lower, const T upper, const unsigned split ) {
+        return lower + (upper - lower)*( static_cast<T>( split )*( T(1)/SCALE ) );
+    }
+
+    //! the fraction of [lower, upper] closest to x
+    template< typename T >
+    static inline uint16_t fraction( const T lower, const T upper, const T x ) {
+        if ( !(upper > lower) ) return SCALE/2;
+        const double f = std::round( ( static_cast<double>(x) - lower )/( static_cast<double>(upper) - lower )*SCALE );
+        return static_cast<uint16_t>( std::min( std::max( f, 0. ), SCALE - 1. ) );
+    }
+};
+
+static_assert( sizeof( PackedNode ) == 8, "PackedNode must not be padded." );
+
+}
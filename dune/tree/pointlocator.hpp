@@ -33,21 +33,35 @@
 #pragma once
 
 #include <limits>
+#include <chrono>
+#include <map>
+#include <array>
 #include <vector>
+#include <type_traits>
 #include <unordered_map>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <fem/helper.hpp>
+#include <geometry/spacefillingcurve.hpp>
 #include <tree/node.hpp>
-#include <tree/leafview.hpp>
-#include <tree/levelview.hpp>
+#include <tree/traversal.hpp>
+#include <tree/packednode.hpp>
 #include <error/duneerror.hpp>
+#include <utils/timing.hpp>
 
 
 
 namespace tree {
 
 
-template< class GV >
+/**
+ * IndexReal is the number type of the split values and cull boxes. They only steer the
+ * search, so float halves their footprint, the inside test of the cells stays in Real.
+ */
+template< class GV, typename IndexReal = typename GV::ctype >
 class PointLocator : public Node<GV> {
 //=======================================================================================================
 // public traits
@@ -66,15 +80,13 @@ protected:
     using Node<GV>::_bounding_box;
     using Node<GV>::_balance_factor;
     using Node<GV>::_child;
+    using Node<GV>::_leafSize;
     using Node<GV>::split;
     using Node<GV>::put;
-    using Node<GV>::searchDown;
-    using Node<GV>::searchUp;
 
 
     typedef typename Node<GV>::EntityContainer  EntityContainer;
     typedef typename Node<GV>::VertexContainer  VertexContainer;
-    typedef typename Node<GV>::DepthFirstResult DepthFirstResult;
     typedef typename Traits::Real               Real;
     typedef typename Traits::Entity             Entity;
     typedef typename Traits::EntitySeed         EntitySeed;
@@ -89,23 +101,192 @@ protected:
     static constexpr unsigned dim     = Traits::dim;    //<! grid dimension
     static constexpr unsigned dimw    = Traits::dimw;   //<! world dimension
 
+    static constexpr unsigned NONE    = std::numeric_limits<unsigned>::max();
+    static constexpr unsigned MAX_GROUP = 32;                   //<! queries in flight of the interleaved batch search
+    static constexpr unsigned MAX_LEAF_SIZE = 64;               //<! largest leaf size a memory budget may choose
+
+    static_assert( dim <= 3, "The split axis is encoded in two bits." );
+    static_assert( std::is_floating_point< IndexReal >::value, "IndexReal must be a floating point type." );
+
+    typedef __functor_traversal< IndexReal, dim >   Traversal;
+    typedef tree::CullBox< IndexReal, dim >         CullBox;
+    typedef math::ShortVector< IndexReal, dim >     IndexVector;
+    typedef TraversalStack< MAX_TREE_DEPTH+1 >  Stack;
+
+    //! node of the flat copy of the tree searched by the queries
+    struct FlatNode {
+        static constexpr unsigned LEAF = 3;
+
+        IndexReal   median;
+        unsigned    child[2];       //<! indices in _nodes, NONE if missing
+        unsigned    first;          //<! leafs: first cell in _leafEntities
+        unsigned    info;           //<! split axis or LEAF in the lowest two bits, leafs: number of cells above
+
+        const bool     isLeaf() const { return (info & 3) == LEAF; }
+        const unsigned axis()   const { return info & 3; }
+        const unsigned count()  const { return info >> 2; }
+    };
+
+    //! affine map of a cell, the local coordinates of x are jinv (x - x0), see buildCellMaps()
+    struct CellMap {
+        LinaVector                              x0;     //<! image of the local origin
+        math::SmallMatrix< Real, dim, dim >     jinv;   //<! inverse of the Jacobian
+    };
+
+    const geometry::SpaceFillingCurve _ordering;        //<! order of cells, vertices and nodes in memory
+    const NodeFormat               _preferredFormat;    //<! format given to the constructor
+    NodeFormat                     _format;             //<! the queries search _nodes or _packedNodes
+    const std::size_t              _budget;             //<! bytes the locator may use, 0 for no limit
+
     std::map< unsigned, unsigned > _id2idxEntity;       //<! map from global entity-id to index in _entities
     std::map< unsigned, unsigned > _id2idxVertex;       //<! map from global entity-id to index in _vertices
 
+    std::vector<EntityContainer>   _entityPool;         //<! all codim 0 entities in GridView, in curve order
+    std::vector<VertexContainer>   _vertexPool;         //<! all vertices in GridView, in curve order
     std::vector<EntityContainer*>  _entities;           //<! EntityContainer for all codim 0 entities in GridView
+
+    std::vector<FlatNode>          _nodes;              //<! depth first, the child first on the curve first
+    std::vector<PackedNode>        _packedNodes;        //<! the same order, replaces _nodes with NodeFormat::Packed
+    std::vector<unsigned>          _leafEntities;       //<! cells of the leafs, contiguous per leaf
+    std::vector<unsigned>          _leafVertices;       //<! leaf j holds _vertexPool[ _leafVertices[j], _leafVertices[j+1] )
+    std::vector<CullBox>           _cellBoxes;          //<! bounding boxes of the cells, same order as _entityPool
+    std::vector<CellMap>           _cellMaps;           //<! same order as _entityPool, empty unless enabled and all cells are affine
+    unsigned                       _depth;              //<! of the deepest leaf in _nodes, the root has depth 0
+    Real                           _overlap;            //<! of the splits after the last refit(), 0 after a build
+    bool                           _useCellMaps;        //<! build _cellMaps with the tree, see useCellMaps()
+    const Dune::GenericReferenceElement< Real, dim >* _cellReference;  //<! reference element of all cells while _cellMaps is filled
+
+    mutable ThreadQueryStatistics  _queryStats;         //<! per thread traversal statistics, see querystats.hpp
+
+    //! a point and its rounding to IndexReal, the tree is searched with xi, the cells are tested with x
+    struct Query {
+        LinaVector  x;
+        IndexVector xi;
+
+        Query() {}
+
+        Query( const LinaVector& x_ ) : x(x_) {
+            for ( unsigned k = 0; k < dim; k++ )
+                xi(k) = static_cast<IndexReal>( x(k) );
+        }
+    };
+
+    //! the queries' view of _nodes
+    struct FlatTree {
+        const FlatNode* nodes;
+
+        struct Cursor {
+            unsigned    node;
+        };
+
+        const Cursor   root() const                                     { Cursor c; c.node = 0; return c; }
+        const bool     isLeaf( const unsigned n ) const                 { return nodes[n].isLeaf(); }
+        const unsigned axis  ( const unsigned n ) const                 { return nodes[n].axis(); }
+        const unsigned child ( const unsigned n, const unsigned c ) const { return nodes[n].child[c]; }
+        const unsigned first ( const unsigned n ) const                 { return nodes[n].first; }
+        const unsigned count ( const unsigned n ) const                 { return nodes[n].count(); }
+        const void*    address( const unsigned n ) const                { return nodes + n; }
+
+        //! step to the child on the side of q, to the other one if that is missing
+        void next( Cursor& cur, const Query& q ) const {
+            const FlatNode& node = nodes[cur.node];
+            const unsigned  c    = Traversal::coord( q.xi.data, node.axis() ) < node.median ? 0 : 1;
+            cur.node = ( node.child[c] != NONE ) ? node.child[c] : node.child[1-c];
+        }
+    };
+
+    //! the queries' view of _packedNodes, the cursor carries the box of its node
+    struct PackedTree {
+        const PackedNode*   nodes;
+        IndexReal           lower[dim];         //<! box of the root
+        IndexReal           upper[dim];
+
+        struct Cursor {
+            unsigned    node;
+            IndexReal   lower[dim];
+            IndexReal   upper[dim];
+        };
+
+        const Cursor   root() const {
+            Cursor c;
+            c.node = 0;
+            std::copy( lower, lower+dim, c.lower );
+            std::copy( upper, upper+dim, c.upper );
+            return c;
+        }
+        const bool     isLeaf( const unsigned n ) const                 { return nodes[n].isLeaf(); }
+        const unsigned axis  ( const unsigned n ) const                 { return nodes[n].axis(); }
+        const unsigned child ( const unsigned n, const unsigned c ) const { return nodes[n].child( n, c ); }
+        const unsigned first ( const unsigned n ) const                 { return nodes[n].index; }
+        const unsigned count ( const unsigned n ) const                 { return nodes[n].split; }
+        const void*    address( const unsigned n ) const                { return nodes + n; }
+
+        void next( Cursor& cur, const Query& q ) const {
+            const PackedNode& node = nodes[cur.node];
+            const unsigned    a    = node.axis();
+            const IndexReal   s    = PackedNode::position( cur.lower[a], cur.upper[a], node.split );
+
+            unsigned c = Traversal::coord( q.xi.data, a ) < s ? 0 : 1;
+            if ( !node.has(c) ) c = 1-c;
+            if ( c == 0 ) cur.upper[a] = s;
+            else          cur.lower[a] = s;
+            cur.node = node.child( cur.node, c );
+        }
+    };
    
 //=======================================================================================================
 // public data
 //=======================================================================================================
 public:
+    typedef typename Node<GV>::DepthFirstResult DepthFirstResult;
+    typedef typename Node<GV>::MemoryStats      MemoryStats;
+
+    //! expected work of a query
+    struct QueryCost {
+        Real    depth;          //<! mean depth of the leafs, the nodes a descent loads
+        Real    cells;          //<! mean number of cells per leaf, the box tests without backtracking
+        Real    time;           //<! [ns] per query at the centers of sampled cells
+
+        QueryCost() : depth(0), cells(0), time(0) {}
+
+        std::ostream& operator<< ( std::ostream& out ) const {
+            out << "Expected nodes descended per Query  " << depth << std::endl;
+            out << "Expected cells per Leaf             " << cells << std::endl;
+            out << "Expected time per Query [ns]        " << time  << std::endl;
+            return out;
+        }
+    };
+
+    //! result of findEntity, entity refers to the entity of the own pointer
     struct EntityData {
         const EntityPointer                 pointer;
         const Entity&                       entity;
         const FieldVector                   xl;
+        const unsigned                      index;      //<! index of the entity in the grid view's index set
 
-        EntityData( const EntityPointer pointer_,
-                    const Entity&       entity_,
-                    const FieldVector   xl_  ) : pointer(pointer_),  entity(entity_), xl(xl_) {}
+        EntityData( const EntityPointer&    pointer_,
+                    const FieldVector&      xl_,
+                    const unsigned          index_ ) : pointer(pointer_),  entity(*pointer), xl(xl_), index(index_) {}
+
+        EntityData( const EntityData& ed ) : pointer(ed.pointer), entity(*pointer), xl(ed.xl), index(ed.index) {}
+    };
+
+    //! results of a batch of queries, entry p belongs to point p
+    struct BatchResult {
+        typedef math::ShortVectorArray< Real, dim >  Points;
+
+        std::vector< const EntityContainer* >   entity;     //<! NULL if the point is outside the grid
+        Points                                  xl;         //<! local coordinates in entity
+        geometry::MortonOrder< Real, dim >      order;      //<! order the points were processed in
+
+        void resize( const unsigned n ) {
+            entity.resize( n );
+            xl.resize( n );
+        }
+
+        const unsigned found() const {
+            return entity.size() - std::count( entity.begin(), entity.end(), static_cast< const EntityContainer* >( NULL ) );
+        }
     };
    
    
@@ -114,10 +295,24 @@ public:
 //=======================================================================================================
 public:
     //== constructor / destructor =======================================================================
-    PointLocator( const PointLocator<GridView>& root ) = delete;
+    PointLocator( const PointLocator& root ) = delete;
 
-    PointLocator( const GridView& gridview, const bool bal = false ) :
-        Node<GV>(NULL,gridview, bal)
+    /**
+     * With a budget > 0 the leaf size and node format are chosen to keep the locator below
+     * budget bytes, see fitBudget().
+     */
+    PointLocator( const GridView& gridview, const bool bal = false,
+                  const geometry::SpaceFillingCurve ordering = geometry::SpaceFillingCurve::Hilbert,
+                  const NodeFormat format = NodeFormat::Flat, const std::size_t budget = 0 ) :
+        Node<GV>(NULL,gridview, bal),
+        _ordering( ordering ),
+        _preferredFormat( format ),
+        _format( format ),
+        _budget( budget ),
+        _depth( 0 ),
+        _overlap( 0 ),
+        _useCellMaps( false ),
+        _cellReference( NULL )
     {
         build();
     }
@@ -129,32 +324,45 @@ public:
     //! bottom up release children and entity/vertex container
     virtual void release() {
         Node<GV>::release();
-        for ( auto e : _entities )
-            safe_delete( e );
-        for ( auto v : _vertices )
-            safe_delete( v );
         _entities.clear();
         _vertices.clear();
+        _entityPool.clear();
+        _vertexPool.clear();
+        _nodes.clear();
+        _packedNodes.clear();
+        _leafEntities.clear();
+        _leafVertices.clear();
+        _cellBoxes.clear();
+        _cellMaps.clear();
+        _cellReference = NULL;
+        _depth = 0;
+        _overlap = 0;
+        _id2idxEntity.clear();
+        _id2idxVertex.clear();
+        _bounding_box = typename Traits::BoundingBox();
     }
 
     //== build tree =====================================================================================
     void build() {
-        std::vector< VertexContainer* > _l_vertices;
-
-        const auto& idSet = _grid.globalIdSet();
+        TIMING_SCOPE( "PointLocator::build" );
+        const auto& idSet    = _grid.globalIdSet();
+        const auto& indexSet = _gridView.indexSet();
 
         // collect cells on leaf view
+        _entityPool.reserve( _gridView.size(0) );
         for( auto e = _gridView.template begin<0>(); e != _gridView.template end<0>(); ++e ) {
-            _entities.push_back( new EntityContainer(e->seed()) );
-            _entities.back()->_id = idSet.id(*e);
-            _id2idxEntity[idSet.id(*e)] = _entities.size()-1;
+            _entityPool.push_back( EntityContainer(e->seed()) );
+            _entityPool.back()._id    = idSet.id(*e);
+            _entityPool.back()._index = indexSet.index(*e);
+            _id2idxEntity[idSet.id(*e)] = _entityPool.size()-1;
         }
 
         // collect vertices on leaf view
+        _vertexPool.reserve( _gridView.size(dim) );
         for( auto e = _gridView.template begin<dim>(); e != _gridView.template end<dim>(); ++e ) {
-            _l_vertices.push_back( new VertexContainer(e->seed()) );
-            _l_vertices.back()->_id = idSet.id(*e);
-            _id2idxVertex[idSet.id(*e)] = _l_vertices.size()-1;
+            _vertexPool.push_back( VertexContainer(e->seed()) );
+            _vertexPool.back()._id = idSet.id(*e);
+            _id2idxVertex[idSet.id(*e)] = _vertexPool.size()-1;
         }
 
         // fill container of all entity seeds
@@ -170,81 +378,1006 @@ public:
                 const auto& c  = *pc;
                 typename Traits::LinaVector gl = fem::asShortVector<Real, dim>( geo.global( gre.position(k,dim) ) ) ;
 
-                VertexContainer* _v = _l_vertices[ _id2idxVertex[ idSet.id(c) ] ];
+                VertexContainer& _v = _vertexPool[ _id2idxVertex[ idSet.id(c) ] ];
 
                 // store global coordinates of all vertices
                 _bounding_box.append(gl);
-                _entities[idx]->_bb.append(gl);
-                _v->_global = gl;
-                _v->_entity_seeds.push_back( idx );
+                _entityPool[idx]._bb.append(gl);
+                _v._global = gl;
+                _v._entity_seeds.push_back( idx );
             }
         }
 
+        renumber();
+
+        // the pools are complete, pointers into them stay valid until release()
+        _entities.reserve( _entityPool.size() );
+        for ( auto& e : _entityPool )
+            _entities.push_back( &e );
+
+        if ( _useCellMaps )
+            buildCellMaps();
+
+        _format   = _preferredFormat;
+        _leafSize = 1;
+        buildTree();
+        if ( _budget > 0 )
+            fitBudget();
+        if ( _format == NodeFormat::Packed )
+            pack();
+    }
+
+    //! the tree over the vertices, flattened to the nodes the queries search and released
+    void buildTree() {
+        std::vector< VertexContainer* > _l_vertices;
+        _l_vertices.reserve( _vertexPool.size() );
+        for ( auto& v : _vertexPool )
+            _l_vertices.push_back( &v );
+
         // generate list of vertices
         this->put( _l_vertices.begin(), _l_vertices.end() );
         optimize();
 //         this->balance();
 //         this->reput();
 //         optimize();
+        flatten();
     }
-    
+
+    /**
+     * Choose node format and leaf size so the locator fits into the budget, on the flat nodes
+     * before they are packed. The pointer tree is released by then, the cells, vertices and id
+     * maps do not depend on these choices. If they alone exceed the budget it is not met, this
+     * is warned about up front and the build is kept. Otherwise the nodes are packed if needed,
+     * then the leaf size is doubled up to MAX_LEAF_SIZE by merging subtrees, see coarsen().
+     * A larger leaf has fewer nodes above it and its vertices share cells, so the cell lists get
+     * shorter, but a query tests more cell boxes.
+     */
+    void fitBudget() {
+        TIMING_SCOPE( "PointLocator::fitBudget" );
+        const MemoryStats m     = memoryStats();
+        const std::size_t fixed = m.total() - m.nodes - m.leafCells - m.leafVertices;
+        if ( fixed >= _budget ) {
+            std::cout << CE_WARNING << "PointLocator needs " << fixed << " bytes for its cells and vertices alone, the budget is "
+                      << _budget << " bytes" << CE_RESET << std::endl;
+            return;
+        }
+
+        const auto bytes = [&]() {
+            const std::size_t node = ( _format == NodeFormat::Packed ) ? sizeof(PackedNode) : sizeof(FlatNode);
+            return fixed + _nodes.size()*node + ( _leafEntities.size() + _leafVertices.size() )*sizeof(unsigned);
+        };
+        if ( bytes() <= _budget ) return;
+
+        _format = NodeFormat::Packed;
+        while ( (bytes() > _budget) && (_leafSize < MAX_LEAF_SIZE) ) {
+            _leafSize *= 2;
+            coarsen( _leafSize );
+        }
+        if ( bytes() > _budget )
+            std::cout << CE_WARNING << "PointLocator needs " << bytes() << " bytes, the budget is "
+                      << _budget << " bytes" << CE_RESET << std::endl;
+    }
+
+    //! search nodes, cell lists and vertex ranges of the leafs while they are coarsened
+    struct Coarsened {
+        std::vector<FlatNode>   nodes;
+        std::vector<unsigned>   leafEntities;
+        std::vector<unsigned>   leafVertices;
+        std::vector<unsigned>   leafOf;         //<! see flatten()
+    };
+
+    /**
+     * Merge the subtrees of _nodes with at most leafSize vertices into leafs, the nodes above
+     * them keep their splits. The vertices of a subtree are contiguous, so the merged leafs
+     * keep contiguous vertex ranges and their cells are those of the vertices in the range.
+     */
+    void coarsen( const unsigned leafSize ) {
+        std::vector<unsigned> begin, end;
+        vertexRanges( flatTree(), begin, end );
+
+        Coarsened c;
+        c.nodes.reserve( _nodes.size() );
+        c.leafEntities.reserve( _leafEntities.size() );
+        c.leafVertices.reserve( _leafVertices.size() );
+        c.leafVertices.push_back( 0 );
+        c.leafOf.assign( _entityPool.size(), NONE );
+        _depth = 0;
+        coarsen( 0, 0, leafSize, begin, end, c );
+
+        c.nodes.shrink_to_fit();
+        c.leafEntities.shrink_to_fit();
+        c.leafVertices.shrink_to_fit();
+        _nodes.swap( c.nodes );
+        _leafEntities.swap( c.leafEntities );
+        _leafVertices.swap( c.leafVertices );
+    }
+
+    const unsigned coarsen( const unsigned m, const unsigned depth, const unsigned leafSize,
+                            const std::vector<unsigned>& begin, const std::vector<unsigned>& end, Coarsened& c ) {
+        const unsigned n = c.nodes.size();
+        _depth = std::max( _depth, depth );
+
+        FlatNode f = _nodes[m];
+        if ( f.isLeaf() || (end[m] <= begin[m] + leafSize) ) {
+            f.child[0] = NONE;
+            f.child[1] = NONE;
+            f.first    = c.leafEntities.size();
+            for ( unsigned v = begin[m]; v < end[m]; v++ )
+                for ( const unsigned e : _vertexPool[v]._entity_seeds )
+                    if ( c.leafOf[e] != n ) {
+                        c.leafOf[e] = n;
+                        c.leafEntities.push_back( e );
+                    }
+            f.info = FlatNode::LEAF | ( (c.leafEntities.size() - f.first) << 2 );
+            c.leafVertices.push_back( end[m] );
+            c.nodes.push_back( f );
+            return n;
+        }
+        c.nodes.push_back( f );
+
+        // keep the order of the children, the leafs then keep the order of their vertices
+        const unsigned c0 = ( f.child[1] < f.child[0] ) ? 1 : 0;
+        for ( unsigned k : { c0, 1-c0 } )
+            if ( f.child[k] != NONE ) {
+                const unsigned i = coarsen( f.child[k], depth+1, leafSize, begin, end, c );
+                c.nodes[n].child[k] = i;
+            }
+        return n;
+    }
+
     void rebuild() {
         release();
         build();
     }
 
+    /**
+     * Keep an affine map per cell, the inside tests then do not read the grid and a batch can
+     * be located in parallel, see locateParallel(). The maps cost dim + dim*dim Reals per cell,
+     * they are only kept if all cells are affine and of one type. Stays set over rebuilds.
+     */
+    void useCellMaps( const bool use ) {
+        _useCellMaps = use;
+        if ( use ) buildCellMaps();
+        else {
+            std::vector<CellMap>().swap( _cellMaps );
+            _cellReference = NULL;
+        }
+    }
+
+    //! read the affine maps of the cells from the grid, left empty if a cell is not affine or degenerate
+    void buildCellMaps() {
+        TIMING_SCOPE( "PointLocator::buildCellMaps" );
+        std::vector<CellMap>().swap( _cellMaps );
+        _cellReference = NULL;
+
+        const Dune::GenericReferenceElement< Real, dim >* ref = NULL;
+        std::vector<CellMap> maps( _entityPool.size() );
+        const FieldVector origin( 0. );
+        for ( unsigned c = 0; c < _entityPool.size(); c++ ) {
+            const EntityPointer ep( _grid.entityPointer( _entityPool[c]._seed ) );
+            const auto&         geo = ep->geometry();
+            const auto&         gre = Dune::GenericReferenceElements< Real, dim >::general( geo.type() );
+            if ( !geo.affine() || ((ref != NULL) && (ref != &gre)) ) return;
+            ref = &gre;
+
+            const auto& jt = geo.jacobianTransposed( origin );
+            math::SmallMatrix< Real, dim, dim > J;
+            for ( unsigned i = 0; i < dim; i++ )
+                for ( unsigned k = 0; k < dim; k++ )
+                    J(k,i) = jt[i][k];
+            if ( !math::invert( J, maps[c].jinv ) ) return;
+            maps[c].x0 = fem::asShortVector<Real, dim>( geo.global( origin ) );
+        }
+
+        _cellMaps.swap( maps );
+        _cellReference = ref;
+    }
+
+    /**
+     * Follow a grid whose vertices moved while its cells stayed the same, e.g. in ALE runs.
+     * The coordinates of the vertices, the boxes and maps of the cells are read from the grid serially,
+     * only the cull boxes are computed in parallel. The search nodes and the cell lists of the
+     * leafs are kept, only the splits are moved between the vertices of their children, see
+     * refitSplits(). The search stays exact, but a vertex that crossed a split sends the queries
+     * near it into the wrong subtree, so they backtrack. If the ranges of the children overlap by
+     * more than maxOverlap of the ranges of their parents, the locator is rebuilt. Returns true
+     * if it was rebuilt.
+     */
+    const bool refit( const Real maxOverlap = .05 ) {
+        TIMING_SCOPE( "PointLocator::refit" );
+
+        // entity pointers and geometries of the grid are not safe to use from several threads
+        for ( auto& v : _vertexPool ) {
+            const VertexPointer vp( _grid.entityPointer( v._seed ) );
+            v._global = fem::asShortVector<Real, dim>( vp->geometry().center() );
+        }
+
+        for ( auto& ec : _entityPool ) {
+            const EntityPointer ep( _grid.entityPointer( ec._seed ) );
+            const auto&         geo = ep->geometry();
+            ec._bb = typename Traits::BoundingBox();
+            for ( int i = 0; i < geo.corners(); i++ )
+                ec._bb.append( fem::asShortVector<Real, dim>( geo.corner(i) ) );
+        }
+        if ( _useCellMaps )
+            buildCellMaps();
+
+        const int ne = _entityPool.size();
+        #pragma omp parallel for
+        for ( int k = 0; k < ne; k++ )
+            _cellBoxes[k] = CullBox( _entityPool[k]._bb );
+
+        std::vector<Real> median;
+        Real overlap = 0, extent = 0;
+        if ( _format == NodeFormat::Packed ) _bounding_box = refitSplits( packedTree(), median, overlap, extent );
+        else                                 _bounding_box = refitSplits( flatTree(),   median, overlap, extent );
+        _overlap = extent > 0. ? overlap/extent : 0.;
+        if ( _overlap > maxOverlap ) {
+            rebuild();
+            return true;
+        }
+
+        const PackedTree tree = packedTree();
+        std::array< IndexReal, dim > lower, upper;
+        std::copy( tree.lower, tree.lower+dim, lower.begin() );
+        std::copy( tree.upper, tree.upper+dim, upper.begin() );
+        refitNodes( median, 0, lower, upper );
+        return false;
+    }
+
+    /**
+     * New splits of the search nodes from the bounds of their vertices, bottom up. A split is put
+     * halfway between the vertices of the two children along the split axis, a node with one
+     * child is split at the bound of its child's vertices. overlap sums the lengths by which the
+     * ranges of the children overlap, extent the lengths of the nodes' ranges. Returns the bounds
+     * of all vertices.
+     */
+    template< class Tree >
+    const typename Traits::BoundingBox refitSplits( const Tree& tree, std::vector<Real>& median, Real& overlap, Real& extent ) const {
+        const unsigned size = nodeCount();
+        std::vector< typename Traits::BoundingBox > box( size );
+        median.assign( size, 0. );
+
+        // the children follow their parent, the leafs are numbered in the order of their nodes
+        unsigned leaf = _leafVertices.size() - 1;
+        for ( unsigned n = size; n-- > 0; ) {
+            if ( tree.isLeaf( n ) ) {
+                leaf--;
+                for ( unsigned v = _leafVertices[leaf]; v < _leafVertices[leaf+1]; v++ )
+                    box[n].append( _vertexPool[v]._global );
+                continue;
+            }
+
+            const unsigned a = tree.axis( n );
+            const unsigned c[2] = { tree.child( n, 0 ), tree.child( n, 1 ) };
+            for ( unsigned i = 0; i < 2; i++ )
+                if ( c[i] != NONE ) box[n].append( box[ c[i] ] );
+
+            if ( (c[0] == NONE) || (c[1] == NONE) ) {
+                if ( c[0] != NONE ) median[n] = box[ c[0] ].corner(a) + box[ c[0] ].dimension(a);
+                if ( c[1] != NONE ) median[n] = box[ c[1] ].corner(a);
+                continue;
+            }
+            const Real upper0 = box[ c[0] ].corner(a) + box[ c[0] ].dimension(a);
+            const Real lower1 = box[ c[1] ].corner(a);
+            median[n] = .5*( upper0 + lower1 );
+            overlap  += std::max( upper0 - lower1, Real(0) );
+            extent   += box[n].dimension(a);
+        }
+        return box[0];
+    }
+
+    //! store the splits below the search node n, in the order of flatten() and pack()
+    void refitNodes( const std::vector<Real>& median, const unsigned n, std::array< IndexReal, dim > lower, std::array< IndexReal, dim > upper ) {
+        unsigned  a, child[2];
+        IndexReal s;
+        if ( _format == NodeFormat::Packed ) {
+            PackedNode& p = _packedNodes[n];
+            if ( p.isLeaf() ) return;
+            a        = p.axis();
+            p.split  = PackedNode::fraction( lower[a], upper[a], static_cast<IndexReal>( median[n] ) );
+            s        = PackedNode::position( lower[a], upper[a], p.split );
+            child[0] = p.child( n, 0 );
+            child[1] = p.child( n, 1 );
+        } else {
+            FlatNode& f = _nodes[n];
+            if ( f.isLeaf() ) return;
+            a        = f.axis();
+            f.median = static_cast<IndexReal>( median[n] );
+            s        = f.median;
+            child[0] = f.child[0];
+            child[1] = f.child[1];
+        }
+
+        if ( child[0] != NONE ) {
+            std::array< IndexReal, dim > u( upper );
+            u[a] = s;
+            refitNodes( median, child[0], lower, u );
+        }
+        if ( child[1] != NONE ) {
+            std::array< IndexReal, dim > l( lower );
+            l[a] = s;
+            refitNodes( median, child[1], l, upper );
+        }
+    }
+
     void optimize() {
             this->update();
             this->deleteEmpty();
             this->removeSingles();
         this->update();
     }
+
+    //! sort cells and vertices along the space filling curve through the bounding box of the grid
+    void renumber() {
+        if ( _ordering == geometry::SpaceFillingCurve::None ) return;
+
+        const std::vector<unsigned> e2e = sortAlongCurve( _entityPool, []( const EntityContainer& e ) { return e._bb.center; } );
+        for ( auto& m : _id2idxEntity )
+            m.second = e2e[m.second];
+
+        for ( auto& v : _vertexPool )
+            for ( auto& es : v._entity_seeds )
+                es = e2e[es];
+
+        const std::vector<unsigned> v2v = sortAlongCurve( _vertexPool, []( const VertexContainer& v ) { return v._global; } );
+        for ( auto& m : _id2idxVertex )
+            m.second = v2v[m.second];
+    }
+
+    //! reorder pool by the curve key of point(item), returns the map from old to new indices
+    template< class Item, class Point >
+    const std::vector<unsigned> sortAlongCurve( std::vector<Item>& pool, Point point ) const {
+        std::vector< std::pair<uint64_t, unsigned> > key( pool.size() );
+        for ( unsigned k = 0; k < pool.size(); k++ )
+            key[k] = std::make_pair( geometry::sfcKey( _ordering, point( pool[k] ), _bounding_box ), k );
+        std::sort( key.begin(), key.end() );
+
+        std::vector<unsigned> o2n( pool.size() );
+        std::vector<Item>     sorted;
+        sorted.reserve( pool.size() );
+        for ( unsigned k = 0; k < key.size(); k++ ) {
+            sorted.push_back( pool[ key[k].second ] );
+            o2n[ key[k].second ] = k;
+        }
+        pool.swap( sorted );
+        return o2n;
+    }
+
+    /**
+     * Copy the tree to _nodes and release it. The leafs reference their cells in _leafEntities,
+     * their vertices are moved to contiguous ranges of _vertexPool, see _leafVertices.
+     */
+    void flatten() {
+        _nodes.clear();
+        _packedNodes.clear();
+        _leafEntities.clear();
+        _leafVertices.assign( 1, 0 );
+        _depth = 0;
+        std::vector<unsigned> leafOf( _entityPool.size(), NONE );
+        std::vector<unsigned> order;
+        order.reserve( _vertexPool.size() );
+        flatten( this, 0, leafOf, order );
+        assert( _depth <= MAX_TREE_DEPTH );
+        _nodes.shrink_to_fit();
+        _leafEntities.shrink_to_fit();
+        _leafVertices.shrink_to_fit();
+
+        // the pointer tree holds pointers into _vertexPool, release it before the vertices move
+        Node<GV>::release();
+        std::vector< VertexContainer* >().swap( _vertices );
+        reorderVertices( order );
+
+        _cellBoxes.clear();
+        _cellBoxes.reserve( _entityPool.size() );
+        for ( const auto& e : _entityPool )
+            _cellBoxes.push_back( CullBox( e._bb ) );
+    }
+
+    //! leafOf marks the cells already listed by a leaf, a cell is listed once per leaf, order collects the leafs' vertices
+    const unsigned flatten( const Node<GridView>* node, const unsigned depth, std::vector<unsigned>& leafOf, std::vector<unsigned>& order ) {
+        const unsigned n = _nodes.size();
+        _depth = std::max( _depth, depth );
+
+        FlatNode f;
+        f.median      = static_cast<IndexReal>( node->median() );
+        f.child[0]    = NONE;
+        f.child[1]    = NONE;
+        f.first       = _leafEntities.size();
+        f.info        = node->orientation();
+
+        if ( node->isLeaf() ) {
+            for ( unsigned k = 0; k < node->vertex_size(); k++ ) {
+                order.push_back( node->vertex(k) - _vertexPool.data() );
+                for ( const unsigned c : node->vertex(k)->_entity_seeds )
+                    if ( leafOf[c] != n ) {
+                        leafOf[c] = n;
+                        _leafEntities.push_back( c );
+                    }
+            }
+            _leafVertices.push_back( order.size() );
+            f.info = FlatNode::LEAF | ( (_leafEntities.size() - f.first) << 2 );
+            _nodes.push_back( f );
+            return n;
+        }
+        _nodes.push_back( f );
+
+        // place the subtree holding the vertex first on the curve first
+        unsigned c0 = 0;
+        if ( (_ordering != geometry::SpaceFillingCurve::None) && node->child(0) && node->child(1) )
+            c0 = firstVertex( node->child(1) ) < firstVertex( node->child(0) ) ? 1 : 0;
+
+        for ( unsigned c : { c0, 1-c0 } )
+            if ( node->child(c) ) {
+                const unsigned i = flatten( node->child(c), depth+1, leafOf, order );
+                _nodes[n].child[c] = i;
+            }
+
+        return n;
+    }
+
+    //! move vertex order[k] to k, the leafs then hold contiguous ranges in the order of their nodes
+    void reorderVertices( const std::vector<unsigned>& order ) {
+        assert( order.size() == _vertexPool.size() );
+        std::vector<unsigned>        o2n( order.size() );
+        std::vector<VertexContainer> sorted;
+        sorted.reserve( order.size() );
+        for ( unsigned k = 0; k < order.size(); k++ ) {
+            sorted.push_back( _vertexPool[ order[k] ] );
+            o2n[ order[k] ] = k;
+        }
+        _vertexPool.swap( sorted );
+        for ( auto& m : _id2idxVertex )
+            m.second = o2n[m.second];
+    }
+
+    //! encode _nodes as PackedNode and release them, the splits relative to the boxes the descent derives
+    void pack() {
+        _packedNodes.resize( _nodes.size() );
+
+        const PackedTree tree = packedTree();
+        std::array< IndexReal, dim > lower, upper;
+        std::copy( tree.lower, tree.lower+dim, lower.begin() );
+        std::copy( tree.upper, tree.upper+dim, upper.begin() );
+        pack( 0, lower, upper );
+
+        std::vector<FlatNode>().swap( _nodes );
+    }
+
+    void pack( const unsigned n, std::array< IndexReal, dim > lower, std::array< IndexReal, dim > upper ) {
+        const FlatNode& f = _nodes[n];
+        PackedNode&     p = _packedNodes[n];
+
+        if ( f.isLeaf() ) {
+            if ( f.count() > std::numeric_limits<uint16_t>::max() )
+                throw GridError( "Too many cells at a vertex for the packed node format!", __ERROR_INFO__ );
+            p.index = f.first;
+            p.split = f.count();
+            p.info  = PackedNode::LEAF;
+            return;
+        }
+
+        const unsigned a = f.axis();
+        p.split = PackedNode::fraction( lower[a], upper[a], f.median );
+        p.info  = a | ( (f.child[0] != NONE) ? PackedNode::LEFT : 0 ) | ( (f.child[1] != NONE) ? PackedNode::RIGHT : 0 )
+                    | ( (f.child[1] == n+1) ? PackedNode::SWAPPED : 0 );
+        p.index = NONE;
+        for ( unsigned c = 0; c < 2; c++ )
+            if ( (f.child[c] != NONE) && (f.child[c] != n+1) )
+                p.index = f.child[c];
+
+        const IndexReal s = PackedNode::position( lower[a], upper[a], p.split );
+        if ( f.child[0] != NONE ) {
+            std::array< IndexReal, dim > u( upper );
+            u[a] = s;
+            pack( f.child[0], lower, u );
+        }
+        if ( f.child[1] != NONE ) {
+            std::array< IndexReal, dim > l( lower );
+            l[a] = s;
+            pack( f.child[1], l, upper );
+        }
+    }
+
+    const FlatTree flatTree() const {
+        FlatTree tree;
+        tree.nodes = _nodes.data();
+        return tree;
+    }
+
+    const PackedTree packedTree() const {
+        PackedTree tree;
+        tree.nodes = _packedNodes.data();
+        for ( unsigned k = 0; k < dim; k++ ) {
+            tree.lower[k] = static_cast<IndexReal>( _bounding_box.corner(k) );
+            tree.upper[k] = static_cast<IndexReal>( _bounding_box.corner(k) + _bounding_box.dimension(k) );
+        }
+        return tree;
+    }
+
+    const std::size_t nodeCount() const {
+        return ( _format == NodeFormat::Packed ) ? _packedNodes.size() : _nodes.size();
+    }
+
+    /**
+     * Vertices below each search node, the range [ begin[n], end[n] ) of _vertexPool. A subtree
+     * is contiguous in the node order, so are the vertices of its leafs.
+     */
+    template< class Tree >
+    void vertexRanges( const Tree& tree, std::vector<unsigned>& begin, std::vector<unsigned>& end ) const {
+        const unsigned size = nodeCount();
+        begin.assign( size, NONE );
+        end.assign( size, 0 );
+
+        unsigned leaf = _leafVertices.size() - 1;
+        for ( unsigned n = size; n-- > 0; ) {
+            if ( tree.isLeaf( n ) ) {
+                leaf--;
+                begin[n] = _leafVertices[leaf];
+                end[n]   = _leafVertices[leaf+1];
+                continue;
+            }
+            for ( unsigned c = 0; c < 2; c++ )
+                if ( tree.child( n, c ) != NONE ) {
+                    begin[n] = std::min( begin[n], begin[ tree.child( n, c ) ] );
+                    end[n]   = std::max( end[n],   end  [ tree.child( n, c ) ] );
+                }
+        }
+    }
+
+    //! smallest index in _vertexPool of the vertices below node
+    const unsigned firstVertex( const Node<GridView>* node ) const {
+        unsigned i = NONE;
+        for ( unsigned k = 0; k < node->vertex_size(); k++ )
+            i = std::min( i, static_cast<unsigned>( node->vertex(k) - _vertexPool.data() ) );
+        return i;
+    }
     
     //== search / iterate tree ==========================================================================
-    const EntityData findEntity( const LinaVector& x )  {
-        // find node containing all possible cells
-        const Node<GridView>* node = searchDown( x );
-        const auto fx  = fem::asFieldVector(x);
-        const auto res = node->searchUp( fx, _entities, node );
+    //! find the entity containing x, does not throw if x is outside the grid but returns found == false
+    const DepthFirstResult locate( const LinaVector& x ) const {
+        TIMING_SCOPE( "PointLocator::locate" );
+        QUERY_STATS( QueryCounters::current().reset() );
+
+        // find leaf containing all possible cells
+        const auto res = search( Query( x ) );
+
+        QUERY_STATS( _queryStats.local().record( QueryCounters::current(), res.found ) );
+        return res;
+    }
+
+    /**
+     * Locate all points of x. Unless the caller passes a coherent stream (sort = false) the
+     * points are processed in Morton order through the grid's bounding box, consecutive
+     * queries then mostly share the upper part of their path and their cells. The results
+     * are stored at the index of their point. The buffers of res are reused, so repeated
+     * batches of similar size do not allocate.
+     *
+     * With group > 1 up to MAX_GROUP queries are kept in flight, see locateInterleaved().
+     * Query statistics count per query and force the sequential search.
+     */
+    void locate( const typename BatchResult::Points& x, BatchResult& res, const bool sort = true, const unsigned group = 16 ) const {
+        TIMING_SCOPE( "PointLocator::locate(batch)" );
+        const unsigned n = x.size();
+        res.resize( n );
+
+        const std::vector<unsigned>& order = sort ? res.order( x, _bounding_box ) : res.order.identity( n );
+        locateRange( x, order.data(), n, res, group );
+    }
+
+    void locate( const std::vector< LinaVector >& x, BatchResult& res, const bool sort = true, const unsigned group = 16 ) const {
+        typename BatchResult::Points xa;
+        math::gather( x, xa );
+        locate( xa, res, sort, group );
+    }
+
+    /**
+     * locate() with the points sorted and split into one contiguous part of the curve per
+     * thread, so the threads keep the coherence of their queries. Needs the cell maps, see
+     * useCellMaps(), without them the inside tests read the grid and the batch is located on
+     * the calling thread.
+     */
+    void locateParallel( const typename BatchResult::Points& x, BatchResult& res, const unsigned group = 16 ) const {
+        if ( _cellMaps.empty() ) {
+            locate( x, res, true, group );
+            return;
+        }
+
+        TIMING_SCOPE( "PointLocator::locateParallel" );
+        const unsigned n = x.size();
+        res.resize( n );
+
+        const std::vector<unsigned>& order = res.order( x, _bounding_box );
+#ifdef _OPENMP
+        const int chunks = omp_get_max_threads();
+#else
+        const int chunks = 1;
+#endif
+        #pragma omp parallel for schedule(static, 1)
+        for ( int c = 0; c < chunks; c++ ) {
+            const std::size_t begin = ( static_cast<std::size_t>( n )*c     )/chunks;
+            const std::size_t end   = ( static_cast<std::size_t>( n )*(c+1) )/chunks;
+            locateRange( x, order.data() + begin, end - begin, res, group );
+        }
+    }
+
+    //! the points order[0, n) of a batch, see locate()
+    void locateRange( const typename BatchResult::Points& x, const unsigned* order, const unsigned n,
+                      BatchResult& res, const unsigned group ) const {
+        if ( (group > 1) && !queryStatsEnabled ) {
+            if ( _format == NodeFormat::Packed ) locateInterleaved( packedTree(), x, order, n, res, std::min( group, MAX_GROUP ) );
+            else                                 locateInterleaved( flatTree(),   x, order, n, res, std::min( group, MAX_GROUP ) );
+            return;
+        }
+
+        for ( unsigned i = 0; i < n; i++ ) {
+            const unsigned p = order[i];
+            QUERY_STATS( QueryCounters::current().reset() );
+
+            const auto r = search( Query( x.get( p ) ) );
+            res.entity[p] = r.entity;
+            for ( unsigned k = 0; k < dim; k++ )
+                res.xl(p,k) = r.xl[k];
+
+            QUERY_STATS( _queryStats.local().record( QueryCounters::current(), r.found ) );
+        }
+    }
+
+    /**
+     * Batch search with group queries in flight. A descent is a chain of dependent loads, so
+     * every round advances each query by one step and prefetches what it needs next, and the
+     * loads of the other queries hide the latency. A query descends one node per round,
+     * then prefetches the cell list of its leaf and then the boxes of the cells, before the
+     * cells are tested and the slot takes the next point.
+     */
+    template< class Tree >
+    void locateInterleaved( const Tree& tree, const typename BatchResult::Points& x, const unsigned* order, const unsigned n,
+                            BatchResult& res, const unsigned group ) const {
+        enum Stage { DESCEND, LEAF, CELLS };
+
+        struct Flight {
+            Query                   q;
+            typename Tree::Cursor   cur;
+            unsigned                p;          //<! index of the point, NONE if the slot is idle
+            Stage                   stage;
+        } flight[MAX_GROUP];
+
+        unsigned       next = 0;
+        unsigned       busy = 0;
+
+        const auto start = [&]( Flight& f ) {
+            if ( next < n ) {
+                f.p     = order[next++];
+                f.q     = Query( x.get( f.p ) );
+                f.cur   = tree.root();
+                f.stage = DESCEND;
+                busy++;
+            } else
+                f.p = NONE;
+        };
+
+        for ( unsigned s = 0; s < group; s++ )
+            start( flight[s] );
 
-        if ( res.found ) {
-            const auto      ep  = _grid.entityPointer( res.es );
+        while ( busy > 0 ) {
+            for ( unsigned s = 0; s < group; s++ ) {
+                Flight& f = flight[s];
+                if ( f.p == NONE ) continue;
+
+                const unsigned node = f.cur.node;
+                switch ( f.stage ) {
+                    case DESCEND:
+                        if ( !tree.isLeaf( node ) ) {
+                            tree.next( f.cur, f.q );
+                            __builtin_prefetch( tree.address( f.cur.node ) );
+                            break;
+                        }
+                        __builtin_prefetch( _leafEntities.data() + tree.first( node ) );
+                        f.stage = LEAF;
+                        break;
+
+                    case LEAF:
+                        for ( unsigned k = tree.first( node ); k < tree.first( node ) + tree.count( node ); k++ )
+                            __builtin_prefetch( &_cellBoxes[ _leafEntities[k] ] );
+                        f.stage = CELLS;
+                        break;
+
+                    case CELLS: {
+                        const auto r = searchFrom( tree, node, f.q );
+                        res.entity[f.p] = r.entity;
+                        for ( unsigned k = 0; k < dim; k++ )
+                            res.xl(f.p,k) = r.xl[k];
+                        busy--;
+                        start( f );
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    const DepthFirstResult search( const Query& q ) const {
+        if ( _format == NodeFormat::Packed ) {
+            const PackedTree tree = packedTree();
+            return searchFrom( tree, descend( tree, q ), q );
+        }
+        const FlatTree tree = flatTree();
+        return searchFrom( tree, descend( tree, q ), q );
+    }
+
+    //! index of the leaf whose region contains q
+    template< class Tree >
+    const unsigned descend( const Tree& tree, const Query& q ) const {
+        auto cur = tree.root();
+        for ( ;; ) {
+            QUERY_STATS( QueryCounters::current().descended++ );
+            if ( tree.isLeaf( cur.node ) ) return cur.node;
+            tree.next( cur, q );
+        }
+    }
+
+    //! search the cells of a leaf, only the cells passing the box test are mapped to local coordinates
+    const DepthFirstResult searchLeaf( const unsigned first, const unsigned count, const Query& q ) const {
+        for ( unsigned k = first; k < first + count; k++ ) {
+            const unsigned c = _leafEntities[k];
+            if ( !Traversal::inside( _cellBoxes[c], q.xi.data ) ) {
+                QUERY_STATS( QueryCounters::current().rejected++ );
+                continue;
+            }
+            QUERY_STATS( QueryCounters::current().tested++ );
+            const EntityContainer& ec = _entityPool[c];
+            if ( !_cellMaps.empty() ) {
+                const CellMap&    m  = _cellMaps[c];
+                const FieldVector xl = fem::asFieldVector( LinaVector( m.jinv*( q.x - m.x0 ) ) );
+                if ( _cellReference->checkInside( xl ) )
+                    return DepthFirstResult( &ec, xl );
+                continue;
+            }
+            const EntityPointer ep( _grid.entityPointer( ec._seed ) );
             const Entity&   e   = *ep;
-            return EntityData( ep, e, res.xl );
+            const auto&     geo = e.geometry();
+            const auto&     gre = Dune::GenericReferenceElements< Real, dim >::general(geo.type());
+            const auto      xl  = geo.local( fem::asFieldVector( q.x ) );
+            if ( gre.checkInside( xl ) )
+                return DepthFirstResult( &ec, xl );
         }
+        return DepthFirstResult( );
+    }
 
-        throw GridError( "Global coordinates are outside the grid!", __ERROR_INFO__ );
+    //! sum depth and cells of the leafs, divided by their number
+    template< class Tree >
+    void leafCost( const Tree& tree, QueryCost& cost ) const {
+        Stack nodes, depths;
+        nodes.push( 0 );
+        depths.push( 0 );
+        unsigned leafs = 0;
+        while ( !nodes.empty() ) {
+            const unsigned n = nodes.pop();
+            const unsigned d = depths.pop();
+            if ( tree.isLeaf( n ) ) {
+                cost.depth += static_cast<Real>( d );
+                cost.cells += static_cast<Real>( tree.count( n ) );
+                leafs++;
+                continue;
+            }
+            for ( unsigned c = 0; c < 2; c++ )
+                if ( tree.child( n, c ) != NONE ) {
+                    nodes.push( tree.child( n, c ) );
+                    depths.push( d+1 );
+                }
+        }
+        if ( leafs > 0 ) {
+            cost.depth /= static_cast<Real>( leafs );
+            cost.cells /= static_cast<Real>( leafs );
+        }
     }
-    
-    //! iterate over all leafs of the node
-    const LeafView<GridView>  leafView() const {
-        return LeafView<GridView>( *this );
+
+    //! depth first search of the subtree below n, uses the stack above its current top
+    template< class Tree >
+    const DepthFirstResult searchSubtree( const Tree& tree, const unsigned n, const Query& q, Stack& stack ) const {
+        const unsigned base = stack.size;
+        stack.push( n );
+        while ( stack.size > base ) {
+            QUERY_STATS( QueryCounters::current().visited++ );
+            const unsigned m = stack.pop();
+            if ( tree.isLeaf( m ) ) {
+                const auto res = searchLeaf( tree.first( m ), tree.count( m ), q );
+                if ( res.found ) return res;
+                continue;
+            }
+            // child 0 is searched first
+            for ( unsigned c = 2; c-- > 0; )
+                if ( tree.child( m, c ) != NONE ) stack.push( tree.child( m, c ) );
+        }
+        return DepthFirstResult( );
     }
 
-     //! iterate over all leafs of the node
-    const LevelView<GridView> levelView(unsigned level) const {
-        return LevelView<GridView>( *this, level );
+    /**
+     * Search the leaf, then climb up and search the siblings passed on the way. Few queries
+     * miss the cells of their leaf, so the descent does not record its path but the path is
+     * found again when needed. The depth first searches of the siblings push their nodes
+     * above the rest of the path, a single stack of depth + 1 entries holds both.
+     */
+    template< class Tree >
+    const DepthFirstResult searchFrom( const Tree& tree, const unsigned leaf, const Query& q ) const {
+        QUERY_STATS( QueryCounters::current().visited++ );
+        const auto res = searchLeaf( tree.first( leaf ), tree.count( leaf ), q );
+        if ( res.found ) return res;
+
+        Stack stack;
+        for ( auto cur = tree.root(); ; tree.next( cur, q ) ) {
+            stack.push( cur.node );
+            if ( tree.isLeaf( cur.node ) ) break;
+        }
+
+        for ( unsigned caller = stack.pop(); !stack.empty(); ) {
+            QUERY_STATS( QueryCounters::current().climbed++ );
+            const unsigned n = stack.pop();
+            for ( unsigned c = 0; c < 2; c++ ) {
+                const unsigned child = tree.child( n, c );
+                if ( (child != NONE) && (child != caller) ) {
+                    const auto res = searchSubtree( tree, child, q, stack );
+                    if ( res.found ) return res;
+                }
+            }
+            caller = n;
+        }
+        return DepthFirstResult( );
     }
 
+    const EntityData findEntity( const LinaVector& x )  {
+        TIMING_SCOPE( "PointLocator::findEntity" );
+        const auto res = locate( x );
+
+        if ( res.found )
+            return EntityData( _grid.entityPointer( res.entity->_seed ), res.xl, res.entity->_index );
+
+        throw GridError( "Global coordinates are outside the grid!", __ERROR_INFO__ );
+    }
+    
     //== information on tree ============================================================================
-    virtual void fillTreeStats( typename Node<GridView>::TreeStats& ts ) {
-        ts.depth = static_cast<unsigned>(this->updateBalanceFactor());
-        
-        Node<GV>::fillTreeStats(ts);
+    virtual void fillTreeStats( typename Node<GridView>::TreeStats& ts ) const {
+        if ( _format == NodeFormat::Packed ) fillNodeStats( packedTree(), ts );
+        else                                 fillNodeStats( flatTree(),   ts );
 
-        ts.numVertices         = _vertices.size();
+        ts.depth               = _depth;
+        ts.numVertices         = _vertexPool.size();
         ts.aveLevel           /= static_cast<Real>( ts.numNodes );
         ts.aveLeafLevel       /= static_cast<Real>( ts.numLeafs );
         ts.aveVertices        /= static_cast<Real>( ts.numNodes );
         ts.aveEntitiesPerLeaf /= static_cast<Real>( ts.numLeafs );
+
+        ts.memory              = memoryStats();
+        ts.queries             = _queryStats.merged();
+    }
+
+    //! levels, vertices and cells of the search nodes, a node with one child is a bad child
+    template< class Tree >
+    void fillNodeStats( const Tree& tree, typename Node<GridView>::TreeStats& ts ) const {
+        std::vector<unsigned> begin, end;
+        vertexRanges( tree, begin, end );
+        std::vector<unsigned> level( begin.size(), 0 );
+
+        for ( unsigned n = 0; n < begin.size(); n++ ) {
+            ts.minLevel  = std::min( ts.minLevel, level[n] );
+            ts.maxLevel  = std::max( ts.maxLevel, level[n] );
+            ts.aveLevel += static_cast<Real>( level[n] );
+
+            const unsigned vs = ( end[n] > begin[n] ) ? end[n] - begin[n] : 0;
+            ts.minVertices  = std::min( ts.minVertices, vs );
+            ts.maxVertices  = std::max( ts.maxVertices, vs );
+            ts.aveVertices += static_cast<Real>( vs );
+
+            ts.numNodes++;
+
+            if ( tree.isLeaf( n ) ) {
+                ts.numLeafs++;
+                ts.minLeafLevel  = std::min( ts.minLeafLevel, level[n] );
+                ts.maxLeafLevel  = std::max( ts.maxLeafLevel, level[n] );
+                ts.aveLeafLevel += static_cast<Real>( level[n] );
+
+                const unsigned cells   = tree.count( n );
+                ts.minEntitiesPerLeaf  = std::min( ts.minEntitiesPerLeaf, cells );
+                ts.maxEntitiesPerLeaf  = std::max( ts.maxEntitiesPerLeaf, cells );
+                ts.aveEntitiesPerLeaf += static_cast<Real>( cells );
+                continue;
+            }
+
+            unsigned children = 0;
+            for ( unsigned c = 0; c < 2; c++ )
+                if ( tree.child( n, c ) != NONE ) {
+                    level[ tree.child( n, c ) ] = level[n] + 1;
+                    children++;
+                }
+            if ( children < 2 ) ts.numBadChildren++;
+        }
+    }
+
+    //! bytes held by the locator, from the capacities of its containers
+    const MemoryStats memoryStats() const {
+        MemoryStats m;
+        m.tree         = sizeof(*this) + this->treeMemory();
+        m.nodes        = _nodes.capacity()*sizeof(FlatNode) + _packedNodes.capacity()*sizeof(PackedNode);
+        m.leafCells    = _leafEntities.capacity()*sizeof(unsigned);
+        m.leafVertices = _leafVertices.capacity()*sizeof(unsigned);
+        m.cullBoxes    = _cellBoxes.capacity()*sizeof(CullBox);
+        m.cellMaps     = _cellMaps.capacity()*sizeof(CellMap);
+        m.entities     = _entityPool.capacity()*sizeof(EntityContainer) + _entities.capacity()*sizeof(EntityContainer*);
+        m.vertices     = _vertexPool.capacity()*sizeof(VertexContainer);
+        for ( const auto& v : _vertexPool )
+            m.adjacency += v._entity_seeds.capacity()*sizeof(unsigned);
+        // a tree node of std::map holds three links and the color besides the value
+        typedef typename std::map< unsigned, unsigned >::value_type IdPair;
+        m.idMaps       = ( _id2idxEntity.size() + _id2idxVertex.size() ) * ( sizeof(IdPair) + 4*sizeof(void*) );
+        return m;
+    }
+
+    /**
+     * Depth and cell count are averaged over the leafs. The time is measured with queries at
+     * the centers of cells spread evenly over _entityPool, so it includes the cache misses of
+     * queries scattered over the grid.
+     */
+    const QueryCost queryCost( const unsigned samples = 1024 ) const {
+        QueryCost cost;
+        if ( _entityPool.empty() ) return cost;
+
+        if ( _format == NodeFormat::Packed ) leafCost( packedTree(), cost );
+        else                                 leafCost( flatTree(),   cost );
+
+        const unsigned n = std::min<std::size_t>( samples, _entityPool.size() );
+        std::vector<Query> queries;
+        queries.reserve( n );
+        for ( unsigned k = 0; k < n; k++ ) {
+            const auto& e = _entityPool[ (static_cast<std::size_t>(k)*_entityPool.size())/n ];
+            queries.push_back( Query( fem::asShortVector<Real, dim>( _grid.entityPointer( e._seed )->geometry().center() ) ) );
+        }
+
+        unsigned found = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for ( const auto& q : queries )
+            found += search( q ).found ? 1 : 0;
+        const auto stop = std::chrono::steady_clock::now();
+        cost.time = std::chrono::duration<Real, std::nano>( stop - start ).count() / static_cast<Real>( n );
+        assert( found == n );
+        return cost;
+    }
+
+    const geometry::SpaceFillingCurve ordering() const { return _ordering; }
+    const NodeFormat                  format()   const { return _format; }
+    const Real                        overlap()  const { return _overlap; }
+
+    //! bytes of the structures the queries search: nodes, cell lists of the leafs, cull boxes and cell maps
+    const std::size_t searchMemory() const {
+        return _nodes.capacity()*sizeof(FlatNode) + _packedNodes.capacity()*sizeof(PackedNode)
+             + _leafEntities.capacity()*sizeof(unsigned) + _cellBoxes.capacity()*sizeof(CullBox)
+             + _cellMaps.capacity()*sizeof(CellMap);
+    }
+
+    const bool hasCellMaps() const { return !_cellMaps.empty(); }
+
+    //! affine map of the cell of a query result, needs hasCellMaps()
+    const CellMap& cellMap( const EntityContainer* e ) const {
+        return _cellMaps[ e - _entityPool.data() ];
+    }
+
+    //! forget the query statistics collected so far, e.g. between benchmark scenarios
+    void resetQueryStats() {
+        _queryStats.reset();
     }
 
     void printTreeStats( std::ostream& out ) {
         typename Node<GridView>::TreeStats ts;
         fillTreeStats(ts);
         ts.operator<<(out) << std::endl;
+        out << "Vertices per Leaf at most           " << _leafSize          << std::endl;
+        out << "Node format                         " << asString( _format ) << std::endl;
+        out << "Overlap of the refitted splits      " << _overlap           << std::endl;
+        queryCost().operator<<(out) << std::endl;
     }
 };
 
+template< class GV, typename IndexReal > constexpr unsigned PointLocator<GV,IndexReal>::NONE;
+template< class GV, typename IndexReal > constexpr unsigned PointLocator<GV,IndexReal>::MAX_GROUP;
+
 
 }
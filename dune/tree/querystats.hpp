@@ -0,0 +1,246 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Traversal statistics of point queries.
+ *
+ * With -DENABLE_QUERY_STATS every query of the point locator counts the work done by the
+ * tree search and records it into histograms of its thread. Without the switch the
+ * QUERY_STATS statements are removed and queries pay nothing.
+ */
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <error/duneerror.hpp>
+
+
+#ifdef ENABLE_QUERY_STATS
+    #define QUERY_STATS( stmt ) stmt
+#else
+    #define QUERY_STATS( stmt )
+#endif
+
+
+namespace tree {
+
+#ifdef ENABLE_QUERY_STATS
+static constexpr bool queryStatsEnabled = true;
+#else
+static constexpr bool queryStatsEnabled = false;
+#endif
+
+
+//! histogram of small non negative integers, one bin per value
+class Histogram {
+protected:
+    std::vector< unsigned long > _bins;
+    unsigned long                _count;
+    unsigned long                _sum;
+
+public:
+    Histogram() : _count(0), _sum(0) {}
+
+    void add( const unsigned v ) {
+        if ( v >= _bins.size() ) _bins.resize( v+1, 0 );
+        _bins[v]++;
+        _count++;
+        _sum += v;
+    }
+
+    void merge( const Histogram& h ) {
+        if ( h._bins.size() > _bins.size() ) _bins.resize( h._bins.size(), 0 );
+        for ( unsigned k = 0; k < h._bins.size(); k++ )
+            _bins[k] += h._bins[k];
+        _count += h._count;
+        _sum   += h._sum;
+    }
+
+    void reset() {
+        _bins.clear();
+        _count = 0;
+        _sum   = 0;
+    }
+
+    const unsigned long count() const { return _count; }
+    const unsigned      max()   const { return _bins.empty() ? 0 : _bins.size()-1; }
+    const double        mean()  const { return _count ? static_cast<double>(_sum)/_count : 0.; }
+
+    //! smallest value v with at least p*count samples <= v
+    const unsigned percentile( const double p ) const {
+        unsigned long n = 0;
+        for ( unsigned k = 0; k < _bins.size(); k++ ) {
+            n += _bins[k];
+            if ( n >= p*_count ) return k;
+        }
+        return max();
+    }
+
+    const std::vector< unsigned long >& bins() const { return _bins; }
+
+    std::ostream& print( std::ostream& out, const std::string& name ) const {
+        out << std::left << std::setw(36) << name << std::right
+            << "mean " << std::setw(10) << mean()
+            << "   p50 " << std::setw(5) << percentile( .5 )
+            << "   p90 " << std::setw(5) << percentile( .9 )
+            << "   p99 " << std::setw(5) << percentile( .99 )
+            << "   max " << std::setw(5) << max() << std::endl;
+        return out;
+    }
+};
+
+
+//! work of a single query, filled while the query descends and climbs the tree
+struct QueryCounters {
+    unsigned descended;     //!> nodes passed on the way down to the leaf containing x
+    unsigned climbed;       //!> levels climbed back up before the cell was found
+    unsigned visited;       //!> nodes entered by the depth first search
+    unsigned rejected;      //!> candidate cells rejected by their bounding box
+    unsigned tested;        //!> candidate cells tested with geo.local
+
+    QueryCounters() { reset(); }
+
+    void reset() {
+        descended = 0;
+        climbed   = 0;
+        visited   = 0;
+        rejected  = 0;
+        tested    = 0;
+    }
+
+    //! counters of the query running on the calling thread
+    static QueryCounters& current() {
+        static thread_local QueryCounters counters;
+        return counters;
+    }
+};
+
+
+//! accumulated query statistics
+struct QueryStatistics {
+    unsigned long   queries;
+    unsigned long   failures;       //!> queries that did not find a cell
+
+    Histogram       descended;
+    Histogram       climbed;
+    Histogram       visited;
+    Histogram       rejected;
+    Histogram       tested;
+
+    QueryStatistics() : queries(0), failures(0) {}
+
+    void record( const QueryCounters& c, const bool found ) {
+        queries++;
+        failures += !found;
+        descended.add( c.descended );
+        climbed  .add( c.climbed   );
+        visited  .add( c.visited   );
+        rejected .add( c.rejected  );
+        tested   .add( c.tested    );
+    }
+
+    void merge( const QueryStatistics& s ) {
+        queries  += s.queries;
+        failures += s.failures;
+        descended.merge( s.descended );
+        climbed  .merge( s.climbed   );
+        visited  .merge( s.visited   );
+        rejected .merge( s.rejected  );
+        tested   .merge( s.tested    );
+    }
+
+    void reset() {
+        *this = QueryStatistics();
+    }
+
+    std::ostream& operator<< ( std::ostream& out ) const {
+        out << "Number of Queries                   " << queries  << std::endl;
+        out << "Number of failed Queries            " << failures << std::endl << std::endl;
+
+        descended.print( out, "Nodes descended per Query" );
+        climbed  .print( out, "Levels climbed per Query" );
+        visited  .print( out, "Nodes searched per Query" );
+        rejected .print( out, "Cells rejected by box per Query" );
+        tested   .print( out, "Cells tested per Query" );
+
+        return out;
+    }
+};
+
+
+//! one QueryStatistics per OpenMP thread, so recording needs no synchronisation
+class ThreadQueryStatistics {
+protected:
+    std::vector< QueryStatistics > _stats;
+
+public:
+    ThreadQueryStatistics() :
+#ifdef _OPENMP
+        _stats( omp_get_max_threads() )
+#else
+        _stats( 1 )
+#endif
+    {}
+
+    QueryStatistics& local() {
+#ifdef _OPENMP
+        const unsigned t = omp_get_thread_num();
+        if ( t >= _stats.size() ) throw GridError( "More threads than at construction of the statistics!", __ERROR_INFO__ );
+        return _stats[t];
+#else
+        return _stats[0];
+#endif
+    }
+
+    const QueryStatistics merged() const {
+        QueryStatistics res;
+        for ( const auto& s : _stats )
+            res.merge( s );
+        return res;
+    }
+
+    void reset() {
+        for ( auto& s : _stats )
+            s.reset();
+    }
+};
+
+
+}
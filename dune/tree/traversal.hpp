@@ -0,0 +1,144 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Inner loops and the traversal stack of the point locator's tree search.
+ *
+ * The generic version loops over the dimension, the specializations for dim = 2 and 3 are
+ * written out: the split coordinate is selected from registers instead of being loaded
+ * through the axis index and the box test combines all comparisons without branches.
+ */
+#pragma once
+
+#include <geometry/boundingbox.hpp>
+
+#include <cmath>
+#include <cassert>
+
+
+namespace tree {
+
+//! deepest tree the locator accepts, bounds the stacks of the traversal
+constexpr unsigned MAX_TREE_DEPTH = 256;
+
+
+/**
+ * Stack of node indices of one query, replaces the recursion and the parent pointers. It
+ * lives on the call stack, a search from the root never holds more than depth + 1 nodes.
+ */
+template< unsigned N >
+struct TraversalStack {
+    unsigned    item[N];
+    unsigned    size;
+
+    TraversalStack() : size(0) {}
+
+    void           push( const unsigned n ) { assert( size < N ); item[size++] = n; }
+    const unsigned pop()                    { return item[--size]; }
+    const bool     empty() const            { return size == 0; }
+};
+
+
+//! conversion of bounds to T, rounding outward if T is narrower than double
+template< typename T >
+struct __functor_outward {
+    static inline T down( const double x ) { return x; }
+    static inline T up  ( const double x ) { return x; }
+};
+
+template< >
+struct __functor_outward< float > {
+    static inline float down( const double x ) {
+        const float f = static_cast<float>( x );
+        return ( f > x ) ? std::nextafter( f, -HUGE_VALF ) : f;
+    }
+    static inline float up( const double x ) {
+        const float f = static_cast<float>( x );
+        return ( f < x ) ? std::nextafter( f, HUGE_VALF ) : f;
+    }
+};
+
+
+/**
+ * Box of a cell used to cull candidates before the exact inside test. With T = float the
+ * bounds are rounded outward. Rounding is monotone, so a point rounded to float does not
+ * leave a box it lies in and no cell containing the point is culled.
+ */
+template< typename T, unsigned dim >
+struct CullBox {
+    T   lower[dim];
+    T   upper[dim];
+
+    CullBox() {}
+
+    template< typename R >
+    CullBox( const geometry::BoundingBox< R, dim >& bb ) {
+        for ( unsigned k = 0; k < dim; k++ ) {
+            lower[k] = __functor_outward< T >::down( bb.corner(k) );
+            upper[k] = __functor_outward< T >::up  ( bb.corner(k) + bb.dimension(k) );
+        }
+    }
+};
+
+
+template< typename T, unsigned dim, bool unrolled = (dim == 2) || (dim == 3) >
+struct __functor_traversal {
+    //! coordinate of x along axis
+    static inline T coord( const T* x, const unsigned axis ) { return x[axis]; }
+
+    static inline bool inside( const CullBox< T, dim >& b, const T* x ) {
+        for ( unsigned k = 0; k < dim; k++ )
+            if ( (x[k] < b.lower[k]) || (x[k] > b.upper[k]) ) return false;
+        return true;
+    }
+};
+
+template< typename T >
+struct __functor_traversal< T, 2, true > {
+    static inline T coord( const T* x, const unsigned axis ) { return axis ? x[1] : x[0]; }
+
+    static inline bool inside( const CullBox< T, 2 >& b, const T* x ) {
+        return (x[0] >= b.lower[0]) & (x[0] <= b.upper[0]) & (x[1] >= b.lower[1]) & (x[1] <= b.upper[1]);
+    }
+};
+
+template< typename T >
+struct __functor_traversal< T, 3, true > {
+    static inline T coord( const T* x, const unsigned axis ) { return axis == 0 ? x[0] : ( axis == 1 ? x[1] : x[2] ); }
+
+    static inline bool inside( const CullBox< T, 3 >& b, const T* x ) {
+        return (x[0] >= b.lower[0]) & (x[0] <= b.upper[0]) & (x[1] >= b.lower[1]) & (x[1] <= b.upper[1])
+             & (x[2] >= b.lower[2]) & (x[2] <= b.upper[2]);
+    }
+};
+
+}
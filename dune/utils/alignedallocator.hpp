@@ -0,0 +1,85 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+/*! \file
+ * Standard allocator returning memory aligned to A bytes, for containers whose contents
+ * are processed by SIMD loops. C++11 std::allocator only guarantees alignof(max_align_t).
+ */
+#pragma once
+
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace alloc {
+
+template< typename T, std::size_t A >
+struct AlignedAllocator {
+    static_assert( (A & (A - 1)) == 0 && (A >= sizeof(void*)), "Alignment must be a power of two and at least the size of a pointer" );
+
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    template< typename U >
+    struct rebind { typedef AlignedAllocator< U, A > other; };
+
+    AlignedAllocator() noexcept {}
+    template< typename U >
+    AlignedAllocator( const AlignedAllocator< U, A >& ) noexcept {}
+
+    //! over-allocates through operator new, so alloc::AllocationCounter sees the allocation, the
+    //! start of the raw block is stored just below the aligned pointer
+    T* allocate( const std::size_t n ) const {
+        char* raw = static_cast< char* >( ::operator new( n*sizeof(T) + A ) );
+        char* p   = raw + A - reinterpret_cast< std::uintptr_t >( raw ) % A;
+        reinterpret_cast< void** >( p )[-1] = raw;
+        return reinterpret_cast< T* >( p );
+    }
+
+    void deallocate( T* p, const std::size_t ) const noexcept {
+        ::operator delete( reinterpret_cast< void** >( p )[-1] );
+    }
+};
+
+template< typename T, typename U, std::size_t A >
+inline bool operator == ( const AlignedAllocator< T, A >&, const AlignedAllocator< U, A >& ) { return true; }
+
+template< typename T, typename U, std::size_t A >
+inline bool operator != ( const AlignedAllocator< T, A >&, const AlignedAllocator< U, A >& ) { return false; }
+
+}
@@ -0,0 +1,131 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Replacement of the global operator new counting heap allocations.
+ *
+ * Defines the replaceable allocation functions, so it must be included by exactly one
+ * translation unit of a program, the one holding main(). Counting is off by default and
+ * only active inside an AllocationCounter scope:
+ *
+ *   alloc::AllocationCounter count;
+ *   ... code that must not allocate ...
+ *   if ( count.allocations() > 0 ) ...
+ */
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+
+namespace alloc {
+
+//! global allocation counter, active while at least one AllocationCounter exists
+struct Counter {
+    static std::atomic< unsigned long >& count() {
+        static std::atomic< unsigned long > c( 0 );
+        return c;
+    }
+
+    static std::atomic< int >& active() {
+        static std::atomic< int > a( 0 );
+        return a;
+    }
+
+    static void* allocate( const std::size_t size ) {
+        if ( active().load( std::memory_order_relaxed ) > 0 )
+            count().fetch_add( 1, std::memory_order_relaxed );
+        return std::malloc( size ? size : 1 );
+    }
+};
+
+//! counts the allocations of all threads during its lifetime
+class AllocationCounter {
+protected:
+    const unsigned long _start;
+
+public:
+    AllocationCounter() : _start( Counter::count().load() ) {
+        Counter::active()++;
+    }
+
+    ~AllocationCounter() {
+        Counter::active()--;
+    }
+
+    const unsigned long allocations() const {
+        return Counter::count().load() - _start;
+    }
+
+    AllocationCounter( const AllocationCounter& ) = delete;
+    AllocationCounter& operator = ( const AllocationCounter& ) = delete;
+};
+
+}
+
+
+void* operator new( std::size_t size ) {
+    void* p = alloc::Counter::allocate( size );
+    if ( p == NULL ) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[]( std::size_t size ) {
+    void* p = alloc::Counter::allocate( size );
+    if ( p == NULL ) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept {
+    return alloc::Counter::allocate( size );
+}
+
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept {
+    return alloc::Counter::allocate( size );
+}
+
+void operator delete( void* p ) noexcept {
+    std::free( p );
+}
+
+void operator delete[]( void* p ) noexcept {
+    std::free( p );
+}
+
+void operator delete( void* p, const std::nothrow_t& ) noexcept {
+    std::free( p );
+}
+
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept {
+    std::free( p );
+}
@@ -0,0 +1,174 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Hardware event counters of the calling thread via perf_event_open.
+ *
+ * Counts user space events only, so perf_event_paranoid <= 2 suffices. Events the kernel
+ * or the virtual machine does not provide are reported as unavailable instead of failing:
+ *
+ *   profiling::PerfCounters pc;
+ *   pc.start();
+ *   ... measured code ...
+ *   pc.stop();
+ *   if ( pc.available( profiling::PerfCounters::L1D_MISSES ) ) ... pc.value( ... )
+ *
+ * The events are opened separately, if the PMU has fewer counters the kernel multiplexes
+ * them. The values are then scaled by the time enabled over the time counted, both taken over
+ * the window from start() to stop() only, the kernel does not reset them.
+ */
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+namespace profiling {
+
+class PerfCounters {
+public:
+    enum Event {
+        CYCLES          = 0,
+        INSTRUCTIONS    = 1,
+        CACHE_MISSES    = 2,    //!> last level cache misses as defined by the kernel
+        L1D_MISSES      = 3,    //!> level 1 data cache read misses
+        LLC_MISSES      = 4,    //!> last level cache read misses
+        DTLB_MISSES     = 5,    //!> data TLB read misses
+        NUM_EVENTS      = 6
+    };
+
+protected:
+    int         _fd   [NUM_EVENTS];
+    uint64_t    _value[NUM_EVENTS];
+    uint64_t    _start[NUM_EVENTS][3];      //!> value, time enabled and time running at start()
+
+#ifdef __linux__
+    static const uint64_t cacheConfig( const uint64_t cache ) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    static const int open( const uint32_t type, const uint64_t config ) {
+        perf_event_attr attr;
+        std::memset( &attr, 0, sizeof(attr) );
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>( syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 ) );
+    }
+#endif
+
+public:
+    PerfCounters() {
+        for ( unsigned k = 0; k < NUM_EVENTS; k++ ) {
+            _fd[k]    = -1;
+            _value[k] = 0;
+            std::fill( _start[k], _start[k]+3, 0 );
+        }
+#ifdef __linux__
+        _fd[CYCLES]       = open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+        _fd[INSTRUCTIONS] = open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+        _fd[CACHE_MISSES] = open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+        _fd[L1D_MISSES]   = open( PERF_TYPE_HW_CACHE, cacheConfig( PERF_COUNT_HW_CACHE_L1D ) );
+        _fd[LLC_MISSES]   = open( PERF_TYPE_HW_CACHE, cacheConfig( PERF_COUNT_HW_CACHE_LL ) );
+        _fd[DTLB_MISSES]  = open( PERF_TYPE_HW_CACHE, cacheConfig( PERF_COUNT_HW_CACHE_DTLB ) );
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for ( unsigned k = 0; k < NUM_EVENTS; k++ )
+            if ( _fd[k] >= 0 ) close( _fd[k] );
+#endif
+    }
+
+    PerfCounters( const PerfCounters& ) = delete;
+    PerfCounters& operator = ( const PerfCounters& ) = delete;
+
+    //! reset and enable all available counters, the running times are kept to take differences in stop()
+    void start() {
+#ifdef __linux__
+        for ( unsigned k = 0; k < NUM_EVENTS; k++ )
+            if ( _fd[k] >= 0 ) {
+                ioctl( _fd[k], PERF_EVENT_IOC_RESET,  0 );
+                if ( read( _fd[k], _start[k], sizeof(_start[k]) ) != sizeof(_start[k]) )
+                    std::fill( _start[k], _start[k]+3, 0 );
+                ioctl( _fd[k], PERF_EVENT_IOC_ENABLE, 0 );
+            }
+#endif
+    }
+
+    //! disable the counters and read their values, scaled up if the event was multiplexed
+    void stop() {
+#ifdef __linux__
+        for ( unsigned k = 0; k < NUM_EVENTS; k++ )
+            if ( _fd[k] >= 0 ) {
+                ioctl( _fd[k], PERF_EVENT_IOC_DISABLE, 0 );
+                uint64_t v[3];      // value, time enabled, time running
+                if ( read( _fd[k], v, sizeof(v) ) != sizeof(v) ) {
+                    _value[k] = 0;
+                    continue;
+                }
+                for ( unsigned i = 0; i < 3; i++ )
+                    v[i] -= _start[k][i];
+                if ( v[2] == 0 )
+                    _value[k] = 0;
+                else
+                    _value[k] = ( v[2] < v[1] ) ? static_cast<uint64_t>( static_cast<double>( v[0] )*v[1]/v[2] ) : v[0];
+            }
+#endif
+    }
+
+    const bool     available( const Event e ) const { return _fd[e] >= 0; }
+    const bool     available()                const { return available( CYCLES ) || available( CACHE_MISSES ); }
+    const uint64_t value    ( const Event e ) const { return _value[e]; }
+
+    static const std::string name( const Event e ) {
+        static const char* names[] = { "cycles", "instructions", "cache-misses", "L1-dcache-load-misses",
+                                       "LLC-load-misses", "dTLB-load-misses" };
+        return names[e];
+    }
+};
+
+}
@@ -0,0 +1,219 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Named profiling regions, enabled at run time.
+ *
+ * A region is profiled if its name is listed in the environment variable PROFILE_REGIONS
+ * or after --profile on the command line, as comma separated name[:backend[+backend]]
+ * entries, "all" matching every region. Backends are
+ *
+ *   cpu    gperftools CPU profile, written to <prefix><name>[.<cycle>].prof (default)
+ *   heap   gperftools heap profile, dumps named <prefix><name>[.<cycle>].*.heap
+ *   perf   enables a "perf record -D -1 --control fd:CTL,ACK" session for the region,
+ *          the descriptors are passed in PERF_CTL_FD and PERF_ACK_FD
+ *
+ * The prefix is taken from PROFILE_PREFIX. Passing a cycle, e.g. the adaptation step,
+ * gives every instance of a region its own file. gperftools profiles cannot be nested,
+ * a region started while another one of the same backend is running is not profiled.
+ *
+ *   PROFILE_REGIONS=rebuild,integrate:perf ./test
+ */
+#pragma once
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include <gperftools/profiler.h>
+#include <gperftools/heap-profiler.h>
+
+#include <utils/utils.hpp>
+
+
+namespace profiling {
+
+enum Backend {
+    NONE    = 0,
+    CPU     = 1,
+    HEAP    = 2,
+    PERF    = 4
+};
+
+
+class Profiler {
+protected:
+    std::map< std::string, unsigned >   _regions;   //!> backends per region name
+    std::string                         _prefix;
+    int                                 _ctlFd;
+    int                                 _ackFd;
+    bool                                _cpuActive;
+    bool                                _heapActive;
+    unsigned                            _perfDepth;
+
+    Profiler() : _ctlFd(-1), _ackFd(-1), _cpuActive(false), _heapActive(false), _perfDepth(0) {}
+
+    static const unsigned parseBackends( const std::string& spec ) {
+        if ( spec.empty() ) return CPU;
+
+        unsigned b = NONE;
+        std::stringstream ss( spec );
+        std::string s;
+        while ( std::getline( ss, s, '+' ) ) {
+            if      ( s == "cpu"  ) b |= CPU;
+            else if ( s == "heap" ) b |= HEAP;
+            else if ( s == "perf" ) b |= PERF;
+            else std::cout << CE_WARNING << "Unknown profiling backend '" << s << "'" << CE_RESET << std::endl;
+        }
+        return b;
+    }
+
+    //! send a command to the perf control descriptor and wait for the acknowledgement
+    const bool perfControl( const char* cmd ) {
+        if ( _ctlFd < 0 ) return false;
+        if ( write( _ctlFd, cmd, std::strlen( cmd ) ) < 0 ) return false;
+        if ( _ackFd >= 0 ) {
+            char c;
+            while ( (read( _ackFd, &c, 1 ) == 1) && (c != '\n') ) {}
+        }
+        return true;
+    }
+
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    //! add regions from a specification name[:backend[+backend]],...
+    void configure( const std::string& spec ) {
+        std::stringstream ss( spec );
+        std::string entry;
+        while ( std::getline( ss, entry, ',' ) ) {
+            if ( entry.empty() ) continue;
+            const auto c = entry.find( ':' );
+            const std::string name = entry.substr( 0, c );
+            _regions[name] |= parseBackends( c == std::string::npos ? "" : entry.substr( c+1 ) );
+        }
+    }
+
+    //! read PROFILE_REGIONS, PROFILE_PREFIX, PERF_CTL_FD, PERF_ACK_FD and --profile <spec>
+    void configure( int argc, char **argv ) {
+        if ( const char* s = std::getenv( "PROFILE_REGIONS" ) ) configure( s );
+        if ( const char* s = std::getenv( "PROFILE_PREFIX" ) )  _prefix = s;
+        if ( const char* s = std::getenv( "PERF_CTL_FD" ) )     _ctlFd  = std::atoi( s );
+        if ( const char* s = std::getenv( "PERF_ACK_FD" ) )     _ackFd  = std::atoi( s );
+
+        for ( int k = 1; k+1 < argc; k++ )
+            if ( std::string( argv[k] ) == "--profile" )
+                configure( argv[k+1] );
+    }
+
+    const unsigned backends( const std::string& name ) const {
+        unsigned b = NONE;
+        auto r = _regions.find( name );
+        if ( r != _regions.end() ) b |= r->second;
+        r = _regions.find( "all" );
+        if ( r != _regions.end() ) b |= r->second;
+        return b;
+    }
+
+    const std::string fileName( const std::string& name, const int cycle ) const {
+        return _prefix + name + ( cycle >= 0 ? "." + asString( cycle ) : std::string() );
+    }
+
+    //! start the configured backends of a region, returns the ones actually started
+    const unsigned start( const std::string& name, const int cycle = -1 ) {
+        const unsigned b = backends( name );
+        unsigned started = NONE;
+
+        if ( (b & CPU) && !_cpuActive ) {
+            if ( ProfilerStart( (fileName( name, cycle ) + ".prof").c_str() ) ) {
+                _cpuActive = true;
+                started   |= CPU;
+            }
+        }
+        if ( (b & HEAP) && !_heapActive ) {
+            HeapProfilerStart( fileName( name, cycle ).c_str() );
+            _heapActive = true;
+            started    |= HEAP;
+        }
+        if ( b & PERF ) {
+            if ( (_perfDepth > 0) || perfControl( "enable\n" ) ) {
+                _perfDepth++;
+                started |= PERF;
+            }
+        }
+        return started;
+    }
+
+    void stop( const std::string& name, const unsigned started ) {
+        if ( started & PERF ) {
+            if ( --_perfDepth == 0 ) perfControl( "disable\n" );
+        }
+        if ( started & HEAP ) {
+            HeapProfilerDump( ("end of " + name).c_str() );
+            HeapProfilerStop();
+            _heapActive = false;
+        }
+        if ( started & CPU ) {
+            ProfilerStop();
+            _cpuActive = false;
+        }
+    }
+};
+
+
+//! profiles its own lifetime with the backends configured for name
+class ProfileRegion {
+protected:
+    const std::string   _name;
+    const unsigned      _started;
+
+public:
+    ProfileRegion( const std::string& name, const int cycle = -1 ) :
+        _name(name), _started( Profiler::instance().start( name, cycle ) ) {}
+
+    ~ProfileRegion() {
+        Profiler::instance().stop( _name, _started );
+    }
+
+    ProfileRegion( const ProfileRegion& ) = delete;
+    ProfileRegion& operator = ( const ProfileRegion& ) = delete;
+};
+
+
+}
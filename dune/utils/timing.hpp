@@ -0,0 +1,324 @@
+//**************************************************************************************//
+//     AUTHOR: Malik Kirchner "malik.kirchner@gmx.net"                                  //
+//             Martin Rückl "martin.rueckl@physik.hu-berlin.de"                         //
+//                                                                                      //
+//     This program is free software: you can redistribute it and/or modify             //
+//     it under the terms of the GNU General Public License as published by             //
+//     the Free Software Foundation, either version 3 of the License, or                //
+//     (at your option) any later version.                                              //
+//                                                                                      //
+//     This program is distributed in the hope that it will be useful,                  //
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of                   //
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    //
+//     GNU General Public License for more details.                                     //
+//                                                                                      //
+//     You should have received a copy of the GNU General Public License                //
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.            //
+//                                                                                      //
+//     Dieses Programm ist Freie Software: Sie können es unter den Bedingungen          //
+//     der GNU General Public License, wie von der Free Software Foundation,            //
+//     Version 3 der Lizenz oder (nach Ihrer Option) jeder späteren                     //
+//     veröffentlichten Version, weiterverbreiten und/oder modifizieren.                //
+//                                                                                      //
+//     Dieses Programm wird in der Hoffnung, dass es nützlich sein wird, aber           //
+//     OHNE JEDE GEWÄHRLEISTUNG, bereitgestellt; sogar ohne die implizite               //
+//     Gewährleistung der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.       //
+//     Siehe die GNU General Public License für weitere Details.                        //
+//                                                                                      //
+//     Sie sollten eine Kopie der GNU General Public License zusammen mit diesem        //
+//     Programm erhalten haben. Wenn nicht, siehe <http://www.gnu.org/licenses/>.       //
+//                                                                                      //
+//**************************************************************************************//
+
+/*! \file
+ * Scoped wall clock timing of nested code regions.
+ *
+ * TIMING_SCOPE( "name" ) times the enclosing scope as a subregion of the region that is
+ * active on the calling thread. Every thread accumulates into its own region tree, so no
+ * synchronisation is needed on the hot path; the trees are merged by region path when the
+ * summary is printed or exported. Scopes opened by OpenMP worker threads are placed below
+ * the region that was active when the parallel region was entered. Without -DENABLE_TIMING
+ * the macro expands to nothing.
+ *
+ * Region names have to be string literals, they are compared by address first.
+ * Summaries must be taken outside of parallel regions.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <error/ioerror.hpp>
+
+
+namespace timing {
+
+#ifdef ENABLE_TIMING
+static constexpr bool enabled = true;
+#else
+static constexpr bool enabled = false;
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+
+//! time spent in a region on one thread
+struct Region {
+    const char*             name;
+    Region*                 parent;
+    std::vector< Region* >  children;
+    unsigned long           calls;
+    double                  time;       //!> [s]
+
+    Region( const char* name_, Region* parent_ ) : name(name_), parent(parent_), calls(0), time(0.) {}
+
+    ~Region() {
+        for ( auto c : children )
+            delete c;
+    }
+
+    Region* child( const char* n ) {
+        for ( auto c : children )
+            if ( (c->name == n) || (std::strcmp( c->name, n ) == 0) ) return c;
+        children.push_back( new Region( n, this ) );
+        return children.back();
+    }
+};
+
+
+//! region trees of all threads
+class Registry {
+public:
+    //! a region merged over all threads
+    struct Entry {
+        std::string             name;
+        std::string             path;
+        unsigned                depth;
+        unsigned long           calls;
+        double                  total;      //!> sum over threads [s]
+        double                  max;        //!> slowest thread [s]
+        unsigned                threads;
+        std::vector< Entry >    children;
+
+        Entry( const std::string& name_, const std::string& path_, const unsigned depth_ ) :
+            name(name_), path(path_), depth(depth_), calls(0), total(0.), max(0.), threads(0) {}
+    };
+
+protected:
+    std::mutex              _mutex;
+    std::vector< Region* >  _roots;
+    std::atomic< Region* >  _fork;      //!> current region of the thread outside of parallel regions
+
+    Registry() : _fork( NULL ) {}
+
+    ~Registry() {
+        for ( auto r : _roots )
+            delete r;
+    }
+
+    static void merge( Entry& entry, const Region& region ) {
+        for ( const auto c : region.children ) {
+            auto e = entry.children.begin();
+            while ( (e != entry.children.end()) && (e->name != c->name) ) ++e;
+            if ( e == entry.children.end() ) {
+                entry.children.push_back( Entry( c->name, entry.path.empty() ? c->name : entry.path + "/" + c->name, entry.depth+1 ) );
+                e = entry.children.end()-1;
+            }
+
+            e->calls += c->calls;
+            e->total += c->time;
+            e->max    = std::max( e->max, c->time );
+            e->threads += ( c->calls > 0 );
+            merge( *e, *c );
+        }
+    }
+
+    static void flatten( const Entry& entry, std::vector< const Entry* >& list ) {
+        for ( const auto& c : entry.children ) {
+            list.push_back( &c );
+            flatten( c, list );
+        }
+    }
+
+    //! the share of the parent compares the slowest threads, i.e. wall clock time
+    static void print( std::ostream& out, const Entry& e, const double parent ) {
+        out << std::left  << std::setw(40) << std::string( 2*(e.depth-1), ' ' ) + e.name << std::right
+            << std::setw(12) << e.calls << std::setw(14) << e.total << std::setw(14) << e.max
+            << std::setw(14) << e.total/std::max( e.calls, 1ul ) << std::setw(9) << e.threads
+            << std::setw(10) << std::fixed << std::setprecision(1) << 100.*e.max/std::max( parent, 1e-300 )
+            << std::scientific << std::setprecision(4) << std::endl;
+
+        for ( const auto& c : e.children )
+            print( out, c, e.max );
+    }
+
+public:
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    //! root region of the calling thread, created on first use
+    Region* threadRoot() {
+        static thread_local Region* root = NULL;
+        if ( root == NULL ) {
+            std::lock_guard< std::mutex > lock( _mutex );
+            _roots.push_back( new Region( "", NULL ) );
+            root = _roots.back();
+        }
+        return root;
+    }
+
+    //! region the calling thread is currently in
+    static Region*& current() {
+        static thread_local Region* region = NULL;
+        if ( region == NULL ) region = instance().threadRoot();
+        return region;
+    }
+
+    static const bool inParallel() {
+#ifdef _OPENMP
+        return omp_in_parallel();
+#else
+        return false;
+#endif
+    }
+
+    //! publish the region the serial part of the program is in
+    void setFork( Region* region ) {
+        if ( !inParallel() ) _fork.store( region, std::memory_order_relaxed );
+    }
+
+    //! region below which a thread at its root opens new scopes, mirrors the fork path in a parallel region
+    Region* attach( Region* root ) {
+        Region* fork = _fork.load( std::memory_order_relaxed );
+        if ( !inParallel() || (fork == NULL) ) return root;
+
+        std::vector< const char* > path;
+        for ( ; fork->parent != NULL; fork = fork->parent )
+            path.push_back( fork->name );
+
+        Region* region = root;
+        for ( auto n = path.rbegin(); n != path.rend(); ++n )
+            region = region->child( *n );
+        return region;
+    }
+
+    const Entry summary() {
+        std::lock_guard< std::mutex > lock( _mutex );
+        Entry root( "", "", 0 );
+        for ( const auto r : _roots )
+            merge( root, *r );
+        return root;
+    }
+
+    void reset() {
+        std::lock_guard< std::mutex > lock( _mutex );
+        for ( auto r : _roots ) {
+            for ( auto c : r->children )
+                delete c;
+            r->children.clear();
+        }
+    }
+
+    void print( std::ostream& out ) {
+        out << std::left << std::setw(40) << "region" << std::right
+            << std::setw(12) << "calls" << std::setw(14) << "total [s]" << std::setw(14) << "max [s]"
+            << std::setw(14) << "mean [s]"  << std::setw(9)  << "threads" << std::setw(10) << "% parent" << std::endl;
+
+        const Entry root = summary();
+        for ( const auto& c : root.children )
+            print( out, c, c.max );
+    }
+
+    void writeCSV( const std::string& path ) {
+        std::ofstream out( path.c_str() );
+        if ( !out ) throw IOError( "Could not open '" + path + "'!", __ERROR_INFO__ );
+
+        const Entry root = summary();
+        std::vector< const Entry* > list;
+        flatten( root, list );
+
+        out << "region,depth,calls,total_s,max_s,threads" << std::endl;
+        for ( const auto e : list )
+            out << e->path << "," << e->depth << "," << e->calls << "," << e->total << "," << e->max << "," << e->threads << std::endl;
+    }
+
+    void writeJSON( const std::string& path ) {
+        std::ofstream out( path.c_str() );
+        if ( !out ) throw IOError( "Could not open '" + path + "'!", __ERROR_INFO__ );
+
+        const Entry root = summary();
+        std::vector< const Entry* > list;
+        flatten( root, list );
+
+        out << "[" << std::endl;
+        for ( unsigned k = 0; k < list.size(); k++ ) {
+            const auto e = list[k];
+            out << "  {\"region\": \"" << e->path << "\", \"depth\": " << e->depth << ", \"calls\": " << e->calls
+                << ", \"total_s\": " << e->total << ", \"max_s\": " << e->max << ", \"threads\": " << e->threads
+                << "}" << ( k+1 < list.size() ? "," : "" ) << std::endl;
+        }
+        out << "]" << std::endl;
+    }
+};
+
+
+//! times its own lifetime as a subregion of the current region of the calling thread
+class ScopedTimer {
+protected:
+    Region*             _region;
+    Region*             _root;      //!> thread root if this scope attached below the fork path
+    Clock::time_point   _start;
+
+public:
+    ScopedTimer( const char* name ) : _root( NULL ) {
+        Registry&   registry = Registry::instance();
+        Region*&    current  = Registry::current();
+
+        if ( current->parent == NULL ) {
+            _root   = current;
+            current = registry.attach( current );
+        }
+
+        _region = current->child( name );
+        current = _region;
+        registry.setFork( _region );
+        _start  = Clock::now();
+    }
+
+    ~ScopedTimer() {
+        _region->time += std::chrono::duration<double>( Clock::now() - _start ).count();
+        _region->calls++;
+
+        Region*& current = Registry::current();
+        current = _root ? _root : _region->parent;
+        Registry::instance().setFork( current );
+    }
+
+    ScopedTimer( const ScopedTimer& ) = delete;
+    ScopedTimer& operator = ( const ScopedTimer& ) = delete;
+};
+
+}
+
+
+#define TIMING_CONCAT_( a, b ) a ## b
+#define TIMING_CONCAT( a, b )  TIMING_CONCAT_( a, b )
+
+#ifdef ENABLE_TIMING
+    #define TIMING_SCOPE( name ) timing::ScopedTimer TIMING_CONCAT( _timing_scope_, __LINE__ )( name )
+#else
+    #define TIMING_SCOPE( name )
+#endif
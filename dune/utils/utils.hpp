@@ -35,6 +35,7 @@
 #include <sstream>
 #include <string>
 #include <functional>
+#include <chrono>
 #include <sys/time.h>
 
 // #include <error/baseerror.hpp>
@@ -129,10 +130,11 @@ inline std::ostream& operator << ( std::ostream& os, const CnslEsc& val ){
 #endif
 
 
+//! wall clock stop watch, see utils/timing.hpp for instrumenting code regions
 class Timer {
 protected:
-    double ticTime;
-    double tocTime;
+    std::chrono::steady_clock::time_point ticTime;
+    std::chrono::steady_clock::time_point tocTime;
 public:
     Timer();
 
@@ -141,19 +143,19 @@ public:
     std::string tocStr();
 };
 
-Timer::Timer(){
+inline Timer::Timer(){
     tic();
 }
 
-void        Timer::tic(){
-//    timeval t;
-//    gettimeofday(&t,0);
-    ticTime = (double)clock()/(double)CLOCKS_PER_SEC; //(double)t.tv_usec/1000.0;
+inline void        Timer::tic(){
+    ticTime = std::chrono::steady_clock::now();
 }
 
-double      Timer::toc(){
-//    timeval t;
-//    gettimeofday(&t,0);
-    tocTime = (double)clock()/(double)CLOCKS_PER_SEC; //(double)t.tv_usec/1000.0;
-    return tocTime - ticTime;
+inline double      Timer::toc(){
+    tocTime = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>( tocTime - ticTime ).count();
+}
+
+inline std::string Timer::tocStr(){
+    return asString( toc() ) + " s";
 }